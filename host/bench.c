@@ -0,0 +1,1013 @@
+#define _POSIX_C_SOURCE 199309L
+#include "pebble.h"
+#include "fctx.h"
+#include "ffont.h"
+#include "fpath.h"
+#include "fpath_encoder.h"
+#include <math.h>
+#include <time.h>
+
+/*
+ * Host-side benchmark for the fctx rasterizer hot paths.
+ *
+ * Each workload is timed with the platform configuration selected at
+ * compile time (see the Makefile).  On color platforms every workload is
+ * run in both the anti-aliased and the black & white rendering modes.
+ *
+ * usage: bench [repeat-multiplier]
+ */
+
+#define RESOURCE_ID_BENCH_FONT 1
+#define RESOURCE_ID_BENCH_HAND 2
+
+static uint32_t s_repeat = 1;
+static uint32_t s_failures;
+
+// --------------------------------------------------------------------------
+// Timing.
+// --------------------------------------------------------------------------
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void report(const char* name, const char* unit, double value, const char* note) {
+    printf("  %-24s %10.1f %-10s %s\n", name, value, unit, note ? note : "");
+}
+
+/* Counts a failed comparison, so that the run exits nonzero, and returns
+ * the note to report with it.
+ */
+static const char* check(bool match, const char* note) {
+    if (!match) ++s_failures;
+    return match ? note : "MISMATCH";
+}
+
+// --------------------------------------------------------------------------
+// Edge counting.
+// --------------------------------------------------------------------------
+
+static fctx_plot_edge_func s_counted_plot_edge;
+static uint32_t s_edge_count;
+
+static void counting_plot_edge(FContext* fctx, FPoint* a, FPoint* b) {
+    ++s_edge_count;
+    s_counted_plot_edge(fctx, a, b);
+}
+
+static void begin_edge_count(void) {
+    s_edge_count = 0;
+    s_counted_plot_edge = fctx_plot_edge;
+    fctx_plot_edge = counting_plot_edge;
+}
+
+static uint32_t end_edge_count(void) {
+    fctx_plot_edge = s_counted_plot_edge;
+    return s_edge_count;
+}
+
+// --------------------------------------------------------------------------
+// Path data construction.
+// --------------------------------------------------------------------------
+
+typedef struct PathBuilder {
+    uint8_t* data;
+    uint16_t length;
+    uint16_t capacity;
+} PathBuilder;
+
+static void pb_command(PathBuilder* pb, char code, uint16_t pcount, const int16_t* params) {
+    uint16_t size = sizeof(uint16_t) + pcount * sizeof(fixed16_t);
+    if (pb->length + size > pb->capacity) {
+        pb->capacity = pb->capacity ? pb->capacity * 2 : 256;
+        pb->data = realloc(pb->data, pb->capacity);
+    }
+    uint16_t c = (uint16_t)code;
+    memcpy(pb->data + pb->length, &c, sizeof(c));
+    if (pcount) {
+        memcpy(pb->data + pb->length + sizeof(c), params, pcount * sizeof(fixed16_t));
+    }
+    pb->length += size;
+}
+
+#define PB_CMD(pb, code, ...) do { \
+        const int16_t params_[] = { __VA_ARGS__ }; \
+        pb_command((pb), (code), sizeof(params_) / sizeof(int16_t), params_); \
+    } while (0)
+
+static void pb_close(PathBuilder* pb) {
+    pb_command(pb, 'Z', 0, NULL);
+}
+
+/* A rounded rectangle contour built from quadratic corners, the way
+ * TrueType-derived glyph outlines are.  Coordinates are in font units.
+ */
+static void pb_rounded_rect(PathBuilder* pb, int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t r) {
+    PB_CMD(pb, 'M', INT_TO_FIXED(x0 + r), INT_TO_FIXED(y0));
+    PB_CMD(pb, 'H', INT_TO_FIXED(x1 - r));
+    PB_CMD(pb, 'Q', INT_TO_FIXED(x1), INT_TO_FIXED(y0), INT_TO_FIXED(x1), INT_TO_FIXED(y0 + r));
+    PB_CMD(pb, 'V', INT_TO_FIXED(y1 - r));
+    PB_CMD(pb, 'Q', INT_TO_FIXED(x1), INT_TO_FIXED(y1), INT_TO_FIXED(x1 - r), INT_TO_FIXED(y1));
+    PB_CMD(pb, 'L', INT_TO_FIXED(x0 + r), INT_TO_FIXED(y1));
+    PB_CMD(pb, 'Q', INT_TO_FIXED(x0), INT_TO_FIXED(y1), INT_TO_FIXED(x0), INT_TO_FIXED(y1 - r));
+    PB_CMD(pb, 'L', INT_TO_FIXED(x0), INT_TO_FIXED(y0 + r));
+    PB_CMD(pb, 'Q', INT_TO_FIXED(x0), INT_TO_FIXED(y0), INT_TO_FIXED(x0 + r), INT_TO_FIXED(y0));
+    pb_close(pb);
+}
+
+/* A closed blob of smooth cubic segments. */
+static void pb_blob(PathBuilder* pb, int16_t cx, int16_t cy, int16_t r) {
+    int16_t k = r * 552 / 1000;
+    PB_CMD(pb, 'M', INT_TO_FIXED(cx), INT_TO_FIXED(cy - r));
+    PB_CMD(pb, 'C', INT_TO_FIXED(cx + k), INT_TO_FIXED(cy - r), INT_TO_FIXED(cx + r), INT_TO_FIXED(cy - k),
+                    INT_TO_FIXED(cx + r), INT_TO_FIXED(cy));
+    PB_CMD(pb, 'S', INT_TO_FIXED(cx + k), INT_TO_FIXED(cy + r), INT_TO_FIXED(cx), INT_TO_FIXED(cy + r));
+    PB_CMD(pb, 'S', INT_TO_FIXED(cx - r), INT_TO_FIXED(cy + k), INT_TO_FIXED(cx - r), INT_TO_FIXED(cy));
+    PB_CMD(pb, 'S', INT_TO_FIXED(cx - k), INT_TO_FIXED(cy - r), INT_TO_FIXED(cx), INT_TO_FIXED(cy - r));
+    pb_close(pb);
+}
+
+/* A digit-like glyph: an outer contour plus a few counters.  The exact
+ * shapes are unimportant, only that the command mix and edge counts are
+ * representative of a compiled clock font.
+ */
+static void pb_digit(PathBuilder* pb, int digit) {
+    pb_rounded_rect(pb, 40, 0, 560, 700, 120 + 10 * digit);
+    for (int k = 0; k <= digit % 3; ++k) {
+        int16_t y = 120 + k * (460 / (digit % 3 + 1));
+        pb_rounded_rect(pb, 140, y, 460, y + 140, 60);
+    }
+    if (digit == 0 || digit == 6 || digit == 8 || digit == 9) {
+        pb_blob(pb, 300, 350, 80);
+    }
+}
+
+static void pb_colon(PathBuilder* pb) {
+    pb_blob(pb, 150, 150, 70);
+    pb_blob(pb, 150, 500, 70);
+}
+
+// --------------------------------------------------------------------------
+// Resources.
+// --------------------------------------------------------------------------
+
+static uint8_t* s_font_data;
+static uint8_t* s_hand_data;
+
+static void build_font_resource(void) {
+    enum { RANGE_BEGIN = '0', RANGE_END = ':' + 1, GLYPH_COUNT = RANGE_END - RANGE_BEGIN };
+    PathBuilder outlines[GLYPH_COUNT];
+    memset(outlines, 0, sizeof(outlines));
+    size_t path_size = 0;
+    for (int k = 0; k < GLYPH_COUNT; ++k) {
+        if (RANGE_BEGIN + k == ':') {
+            pb_colon(&outlines[k]);
+        } else {
+            pb_digit(&outlines[k], k);
+        }
+        path_size += outlines[k].length;
+    }
+
+    FFont header = {
+        .units_per_em = INT_TO_FIXED(1000),
+        .ascent = INT_TO_FIXED(800),
+        .descent = INT_TO_FIXED(-200),
+        .cap_height = INT_TO_FIXED(700),
+        .glyph_index_length = 1,
+        .glyph_table_length = GLYPH_COUNT,
+    };
+    FGlyphRange range = { RANGE_BEGIN, RANGE_END };
+
+    size_t size = sizeof(FFont) + sizeof(FGlyphRange) + GLYPH_COUNT * sizeof(FGlyph) + path_size;
+    s_font_data = malloc(size);
+    uint8_t* p = s_font_data;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    memcpy(p, &range, sizeof(range));
+    p += sizeof(range);
+    uint16_t offset = 0;
+    for (int k = 0; k < GLYPH_COUNT; ++k) {
+        FGlyph glyph = {
+            .path_data_offset = offset,
+            .path_data_length = outlines[k].length,
+            .horiz_adv_x = INT_TO_FIXED(RANGE_BEGIN + k == ':' ? 300 : 600),
+        };
+        memcpy(p, &glyph, sizeof(glyph));
+        p += sizeof(glyph);
+        offset += outlines[k].length;
+    }
+    for (int k = 0; k < GLYPH_COUNT; ++k) {
+        memcpy(p, outlines[k].data, outlines[k].length);
+        p += outlines[k].length;
+        free(outlines[k].data);
+    }
+    host_resource_register(RESOURCE_ID_BENCH_FONT, s_font_data, size);
+}
+
+/* A tapered clock hand pointing up from the origin, in pixels. */
+static void build_hand_resource(void) {
+    PathBuilder pb = {0};
+    PB_CMD(&pb, 'M', INT_TO_FIXED(-4), INT_TO_FIXED(10));
+    PB_CMD(&pb, 'C', INT_TO_FIXED(-6), INT_TO_FIXED(-20), INT_TO_FIXED(-3), INT_TO_FIXED(-45), INT_TO_FIXED(0), INT_TO_FIXED(-60));
+    PB_CMD(&pb, 'C', INT_TO_FIXED(3), INT_TO_FIXED(-45), INT_TO_FIXED(6), INT_TO_FIXED(-20), INT_TO_FIXED(4), INT_TO_FIXED(10));
+    PB_CMD(&pb, 'Q', INT_TO_FIXED(3), INT_TO_FIXED(15), INT_TO_FIXED(0), INT_TO_FIXED(15));
+    PB_CMD(&pb, 'T', INT_TO_FIXED(-4), INT_TO_FIXED(10));
+    pb_close(&pb);
+    s_hand_data = pb.data;
+    host_resource_register(RESOURCE_ID_BENCH_HAND, s_hand_data, pb.length);
+}
+
+// --------------------------------------------------------------------------
+// Workloads.
+// --------------------------------------------------------------------------
+
+typedef struct Bench {
+    GContext* gctx;
+    FContext fctx;
+    GSize size;
+    FFont* font;
+    FPath* hand;
+    uint32_t frame_checksum;
+} Bench;
+
+static uint32_t s_rand_state = 12345;
+
+static int32_t rand_range(int32_t lo, int32_t hi) {
+    s_rand_state = s_rand_state * 1103515245u + 12345u;
+    return lo + (int32_t)((s_rand_state >> 8) % (uint32_t)(hi - lo));
+}
+
+static uint32_t frame_checksum(Bench* b) {
+    GBitmap* fb = graphics_capture_frame_buffer(b->gctx);
+    uint32_t hash = 2166136261u;
+    for (int16_t y = 0; y < b->size.h; ++y) {
+        GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y);
+#ifdef PBL_BW
+        int16_t min_x = row.min_x / 8;
+        int16_t max_x = row.max_x / 8;
+#else
+        int16_t min_x = row.min_x;
+        int16_t max_x = row.max_x;
+#endif
+        for (int16_t x = min_x; x <= max_x; ++x) {
+            hash = (hash ^ row.data[x]) * 16777619u;
+        }
+    }
+    graphics_release_frame_buffer(b->gctx, fb);
+    return hash;
+}
+
+static void clear_frame(Bench* b) {
+    GBitmap* fb = graphics_capture_frame_buffer(b->gctx);
+    for (int16_t y = 0; y < b->size.h; ++y) {
+        GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y);
+#ifdef PBL_BW
+        memset(row.data + row.min_x / 8, 0x00, row.max_x / 8 - row.min_x / 8 + 1);
+#else
+        memset(row.data + row.min_x, GColorBlackARGB8, row.max_x - row.min_x + 1);
+#endif
+    }
+    graphics_release_frame_buffer(b->gctx, fb);
+}
+
+/* Number of pixels the end_fill resolve loop will visit for the current extent. */
+static uint32_t resolve_pixels(Bench* b) {
+    int32_t rows = FIXED_TO_INT(b->fctx.extent_max.y) - FIXED_TO_INT(b->fctx.extent_min.y) + 1;
+    int32_t cols = FIXED_TO_INT(b->fctx.extent_max.x) - FIXED_TO_INT(b->fctx.extent_min.x) + 1;
+    if (rows > b->size.h) rows = b->size.h;
+    if (cols > b->size.w) cols = b->size.w;
+    return (rows > 0 && cols > 0) ? (uint32_t)(rows * cols) : 0;
+}
+
+static void bench_plot_edge(Bench* b) {
+    enum { EDGE_COUNT = 256 };
+    FPoint edges[EDGE_COUNT][2];
+    for (int k = 0; k < EDGE_COUNT; ++k) {
+        edges[k][0] = FPoint(rand_range(-INT_TO_FIXED(20), INT_TO_FIXED(b->size.w + 20)),
+                             rand_range(-INT_TO_FIXED(20), INT_TO_FIXED(b->size.h + 20)));
+        edges[k][1] = FPoint(rand_range(-INT_TO_FIXED(20), INT_TO_FIXED(b->size.w + 20)),
+                             rand_range(-INT_TO_FIXED(20), INT_TO_FIXED(b->size.h + 20)));
+    }
+
+    /* An even number of passes leaves the flag buffer clear. */
+    uint32_t passes = 200 * s_repeat;
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (int k = 0; k < EDGE_COUNT; ++k) {
+            fctx_plot_edge(&b->fctx, &edges[k][0], &edges[k][1]);
+        }
+    }
+    uint64_t t1 = now_ns();
+    report("fctx_plot_edge", "ns/edge", (double)(t1 - t0) / (passes * EDGE_COUNT), "random edges across the screen");
+}
+
+static void bench_plot_circle(Bench* b) {
+    enum { CIRCLE_COUNT = 16 };
+    FPoint centers[CIRCLE_COUNT];
+    fixed_t radii[CIRCLE_COUNT];
+    for (int k = 0; k < CIRCLE_COUNT; ++k) {
+        centers[k] = FPoint(rand_range(0, INT_TO_FIXED(b->size.w)), rand_range(0, INT_TO_FIXED(b->size.h)));
+        radii[k] = rand_range(INT_TO_FIXED(4), INT_TO_FIXED(b->size.w / 2));
+    }
+
+    uint32_t passes = 200 * s_repeat;
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (int k = 0; k < CIRCLE_COUNT; ++k) {
+            fctx_plot_circle(&b->fctx, &centers[k], radii[k]);
+        }
+    }
+    uint64_t t1 = now_ns();
+    report("fctx_plot_circle", "ns/circle", (double)(t1 - t0) / (passes * CIRCLE_COUNT), "radius 4 to w/2");
+    fctx_begin_fill(&b->fctx);
+}
+
+/* Outline of part of a circle as cubic curves of at most a quarter turn, the
+ * way an arc had to be drawn before fctx_plot_arc.
+ */
+static const double k_radians_per_angle = 6.283185307179586 / TRIG_MAX_ANGLE;
+
+static void curve_arc(FContext* fctx, FPoint c, fixed_t r, int32_t a0, int32_t a1) {
+    int32_t pieces = (abs(a1 - a0) + TRIG_MAX_ANGLE / 4 - 1) / (TRIG_MAX_ANGLE / 4);
+    double step = (double)(a1 - a0) / pieces * k_radians_per_angle;
+    double k = 4.0 / 3.0 * tan(step / 4) * r;
+    double a = a0 * k_radians_per_angle;
+    for (int32_t n = 0; n < pieces; ++n, a += step) {
+        double b = a + step;
+        FPoint p0 = FPoint(c.x + r * sin(a), c.y - r * cos(a));
+        FPoint p3 = FPoint(c.x + r * sin(b), c.y - r * cos(b));
+        FPoint cp0 = FPoint(p0.x + k * cos(a), p0.y + k * sin(a));
+        FPoint cp1 = FPoint(p3.x - k * cos(b), p3.y - k * sin(b));
+        if (n == 0) {
+            fctx_line_to(fctx, p0);
+        }
+        fctx_curve_to(fctx, cp0, cp1, p3);
+    }
+}
+
+static void bench_plot_arc(Bench* b) {
+    enum { ARC_COUNT = 16 };
+    FPoint centers[ARC_COUNT];
+    fixed_t radii[ARC_COUNT];
+    int32_t ends[ARC_COUNT];
+    for (int k = 0; k < ARC_COUNT; ++k) {
+        centers[k] = FPoint(rand_range(0, INT_TO_FIXED(b->size.w)), rand_range(0, INT_TO_FIXED(b->size.h)));
+        radii[k] = rand_range(INT_TO_FIXED(10), INT_TO_FIXED(b->size.w / 2));
+        ends[k] = rand_range(TRIG_MAX_ANGLE / 16, TRIG_MAX_ANGLE);
+    }
+
+    /* Progress arcs, a fifth of the radius thick. */
+    uint32_t passes = 200 * s_repeat;
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (int k = 0; k < ARC_COUNT; ++k) {
+            fctx_plot_arc(&b->fctx, &centers[k], radii[k] * 4 / 5, radii[k], 0, ends[k]);
+        }
+    }
+    uint64_t t1 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (int k = 0; k < ARC_COUNT; ++k) {
+            fctx_move_to(&b->fctx, centers[k]);
+            curve_arc(&b->fctx, centers[k], radii[k], 0, ends[k]);
+            curve_arc(&b->fctx, centers[k], radii[k] * 4 / 5, ends[k], 0);
+            fctx_close_path(&b->fctx);
+        }
+    }
+    uint64_t t2 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (int k = 0; k < ARC_COUNT; ++k) {
+            fctx_plot_ring(&b->fctx, &centers[k], radii[k] * 4 / 5, radii[k]);
+        }
+    }
+    uint64_t t3 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (int k = 0; k < ARC_COUNT; ++k) {
+            fctx_plot_circle(&b->fctx, &centers[k], radii[k]);
+            fctx_plot_circle(&b->fctx, &centers[k], radii[k] * 4 / 5);
+        }
+    }
+    uint64_t t4 = now_ns();
+    report("fctx_plot_arc", "ns/arc", (double)(t1 - t0) / (passes * ARC_COUNT), "radius 10 to w/2");
+    report("arc as curves", "ns/arc", (double)(t2 - t1) / (passes * ARC_COUNT), "fctx_curve_to");
+    report("fctx_plot_ring", "ns/ring", (double)(t3 - t2) / (passes * ARC_COUNT), NULL);
+    report("ring as circles", "ns/ring", (double)(t4 - t3) / (passes * ARC_COUNT), "fctx_plot_circle x2");
+    fctx_begin_fill(&b->fctx);
+}
+
+/* A rounded rect outline as cubic curves, the way it had to be drawn before
+ * fctx_plot_rounded_rect.
+ */
+static void curve_rounded_rect(FContext* fctx, const FRect* rect, fixed_t r) {
+    fixed_t x0 = rect->origin.x, y0 = rect->origin.y;
+    fixed_t x1 = x0 + rect->size.w, y1 = y0 + rect->size.h;
+    fixed_t k = r * 9 / 20; /* (1 - 0.5523) * r */
+    fctx_move_to(fctx, FPoint(x0 + r, y0));
+    fctx_line_to(fctx, FPoint(x1 - r, y0));
+    fctx_curve_to(fctx, FPoint(x1 - k, y0), FPoint(x1, y0 + k), FPoint(x1, y0 + r));
+    fctx_line_to(fctx, FPoint(x1, y1 - r));
+    fctx_curve_to(fctx, FPoint(x1, y1 - k), FPoint(x1 - k, y1), FPoint(x1 - r, y1));
+    fctx_line_to(fctx, FPoint(x0 + r, y1));
+    fctx_curve_to(fctx, FPoint(x0 + k, y1), FPoint(x0, y1 - k), FPoint(x0, y1 - r));
+    fctx_line_to(fctx, FPoint(x0, y0 + r));
+    fctx_curve_to(fctx, FPoint(x0, y0 + k), FPoint(x0 + k, y0), FPoint(x0 + r, y0));
+    fctx_close_path(fctx);
+}
+
+static void bench_plot_ellipse(Bench* b) {
+    enum { SHAPE_COUNT = 16 };
+    FRect rects[SHAPE_COUNT];
+    for (int k = 0; k < SHAPE_COUNT; ++k) {
+        rects[k].size.w = rand_range(INT_TO_FIXED(20), INT_TO_FIXED(b->size.w / 2));
+        rects[k].size.h = rand_range(INT_TO_FIXED(12), INT_TO_FIXED(b->size.h / 3));
+        rects[k].origin = FPoint(rand_range(0, INT_TO_FIXED(b->size.w) - rects[k].size.w),
+                                 rand_range(0, INT_TO_FIXED(b->size.h) - rects[k].size.h));
+    }
+
+    uint32_t passes = 200 * s_repeat;
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (int k = 0; k < SHAPE_COUNT; ++k) {
+            FPoint c = FPoint(rects[k].origin.x + rects[k].size.w / 2, rects[k].origin.y + rects[k].size.h / 2);
+            fctx_plot_ellipse(&b->fctx, &c, rects[k].size.w / 2, rects[k].size.h / 2);
+        }
+    }
+    uint64_t t1 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (int k = 0; k < SHAPE_COUNT; ++k) {
+            FRect* r = rects + k;
+            fixed_t rx = r->size.w / 2, ry = r->size.h / 2;
+            fixed_t kx = rx * 11 / 20, ky = ry * 11 / 20; /* 0.5523 * r */
+            FPoint c = FPoint(r->origin.x + rx, r->origin.y + ry);
+            fctx_move_to(&b->fctx, FPoint(c.x, c.y - ry));
+            fctx_curve_to(&b->fctx, FPoint(c.x + kx, c.y - ry), FPoint(c.x + rx, c.y - ky), FPoint(c.x + rx, c.y));
+            fctx_curve_to(&b->fctx, FPoint(c.x + rx, c.y + ky), FPoint(c.x + kx, c.y + ry), FPoint(c.x, c.y + ry));
+            fctx_curve_to(&b->fctx, FPoint(c.x - kx, c.y + ry), FPoint(c.x - rx, c.y + ky), FPoint(c.x - rx, c.y));
+            fctx_curve_to(&b->fctx, FPoint(c.x - rx, c.y - ky), FPoint(c.x - kx, c.y - ry), FPoint(c.x, c.y - ry));
+        }
+    }
+    uint64_t t2 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (int k = 0; k < SHAPE_COUNT; ++k) {
+            fctx_plot_rounded_rect(&b->fctx, &rects[k], INT_TO_FIXED(6));
+        }
+    }
+    uint64_t t3 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (int k = 0; k < SHAPE_COUNT; ++k) {
+            curve_rounded_rect(&b->fctx, &rects[k], INT_TO_FIXED(6));
+        }
+    }
+    uint64_t t4 = now_ns();
+    report("fctx_plot_ellipse", "ns/shape", (double)(t1 - t0) / (passes * SHAPE_COUNT), NULL);
+    report("ellipse as curves", "ns/shape", (double)(t2 - t1) / (passes * SHAPE_COUNT), "fctx_curve_to x4");
+    report("fctx_plot_rounded_rect", "ns/shape", (double)(t3 - t2) / (passes * SHAPE_COUNT), "radius 6");
+    report("rounded rect as curves", "ns/shape", (double)(t4 - t3) / (passes * SHAPE_COUNT), "fctx_curve_to x4");
+    fctx_begin_fill(&b->fctx);
+}
+
+static void bench_bezier(Bench* b) {
+    enum { CURVE_COUNT = 64 };
+    FPoint curves[CURVE_COUNT][4];
+    for (int k = 0; k < CURVE_COUNT; ++k) {
+        for (int j = 0; j < 4; ++j) {
+            curves[k][j] = FPoint(rand_range(0, INT_TO_FIXED(b->size.w)), rand_range(0, INT_TO_FIXED(b->size.h)));
+        }
+    }
+
+    begin_edge_count();
+    fctx_begin_fill(&b->fctx);
+    for (int k = 0; k < CURVE_COUNT; ++k) {
+        fctx_move_to(&b->fctx, curves[k][0]);
+        fctx_curve_to(&b->fctx, curves[k][1], curves[k][2], curves[k][3]);
+    }
+    uint32_t edges = end_edge_count();
+    fctx_end_fill(&b->fctx);
+
+    uint32_t passes = 100 * s_repeat;
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (int k = 0; k < CURVE_COUNT; ++k) {
+            fctx_move_to(&b->fctx, curves[k][0]);
+            fctx_curve_to(&b->fctx, curves[k][1], curves[k][2], curves[k][3]);
+        }
+    }
+    uint64_t t1 = now_ns();
+    char note[64];
+    snprintf(note, sizeof(note), "%.1f edges/curve", (double)edges / CURVE_COUNT);
+    report("bezier (fctx_curve_to)", "ns/curve", (double)(t1 - t0) / (passes * CURVE_COUNT), note);
+    report("bezier (fctx_curve_to)", "ns/edge", (double)(t1 - t0) / (passes * (double)edges), NULL);
+    fctx_begin_fill(&b->fctx);
+}
+
+static void draw_clock_text(Bench* b) {
+    fctx_set_offset(&b->fctx, FPointI(b->size.w / 2, b->size.h / 2));
+    fctx_set_rotation(&b->fctx, 0);
+    fctx_set_text_em_height(&b->fctx, b->font, 40);
+    fctx_draw_string(&b->fctx, "12:34", b->font, GTextAlignmentCenter, FTextAnchorCapMiddle);
+}
+
+/* Draw the hands from the command stream, or from the decoded path or
+ * edge caches if given.
+ */
+static void draw_hands_with(Bench* b, uint32_t minute_angle, const FDecodedPath* decoded, FEdgeCache** caches) {
+    fctx_set_offset(&b->fctx, FPointI(b->size.w / 2, b->size.h / 2));
+    for (int hand = 0; hand < 2; ++hand) {
+        if (hand == 0) {
+            fctx_set_scale(&b->fctx, FPointOne, FPointOne);
+            fctx_set_rotation(&b->fctx, minute_angle);
+        } else {
+            fctx_set_scale(&b->fctx, FPoint(3, 3), FPoint(2, 2));
+            fctx_set_rotation(&b->fctx, minute_angle / 12 + TRIG_MAX_ANGLE / 3);
+        }
+        if (decoded) {
+            fctx_draw_decoded_path(&b->fctx, FPointZero, decoded);
+        } else if (caches) {
+            fctx_draw_commands_cached(&b->fctx, caches[hand], FPointZero, b->hand->data, b->hand->size);
+        } else {
+            fctx_draw_commands(&b->fctx, FPointZero, b->hand->data, b->hand->size);
+        }
+    }
+}
+
+static void draw_hands(Bench* b, uint32_t minute_angle) {
+    draw_hands_with(b, minute_angle, NULL, NULL);
+}
+
+/* Checksum of the hands alone, drawn as by draw_hands_with. */
+static uint32_t hands_checksum(Bench* b, const FDecodedPath* decoded, FEdgeCache** caches) {
+    clear_frame(b);
+    fctx_begin_fill(&b->fctx);
+    draw_hands_with(b, TRIG_MAX_ANGLE / 8, decoded, caches);
+    fctx_end_fill(&b->fctx);
+    return frame_checksum(b);
+}
+
+static void bench_draw_commands(Bench* b) {
+    begin_edge_count();
+    fctx_begin_fill(&b->fctx);
+    draw_hands(b, TRIG_MAX_ANGLE / 8);
+    uint32_t hand_edges = end_edge_count();
+    fctx_end_fill(&b->fctx);
+
+    begin_edge_count();
+    fctx_begin_fill(&b->fctx);
+    draw_clock_text(b);
+    uint32_t text_edges = end_edge_count();
+    fctx_end_fill(&b->fctx);
+
+    /* Each pass draws everything twice so that the flags cancel. */
+    uint32_t passes = 200 * s_repeat;
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        draw_hands(b, TRIG_MAX_ANGLE / 8);
+        draw_hands(b, TRIG_MAX_ANGLE / 8);
+    }
+    uint64_t t1 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        draw_clock_text(b);
+        draw_clock_text(b);
+    }
+    uint64_t t2 = now_ns();
+    FTextLayout* layout = ftext_layout_create("12:34", b->font, GTextAlignmentCenter, FTextAnchorCapMiddle);
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        fctx_draw_layout(&b->fctx, layout);
+        fctx_draw_layout(&b->fctx, layout);
+    }
+    uint64_t t3 = now_ns();
+    ftext_layout_destroy(layout);
+    FDecodedPath* decoded = fpath_decode(b->hand->data, b->hand->size);
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        draw_hands_with(b, TRIG_MAX_ANGLE / 8, decoded, NULL);
+        draw_hands_with(b, TRIG_MAX_ANGLE / 8, decoded, NULL);
+    }
+    uint64_t t4 = now_ns();
+    FEdgeCache* caches[2] = { fedge_cache_create(128), fedge_cache_create(128) };
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        draw_hands_with(b, TRIG_MAX_ANGLE / 8, NULL, caches);
+        draw_hands_with(b, TRIG_MAX_ANGLE / 8, NULL, caches);
+    }
+    uint64_t t5 = now_ns();
+
+    char note[64];
+    snprintf(note, sizeof(note), "2 hands, %u edges", hand_edges);
+    report("fctx_draw_commands", "ns/edge", (double)(t1 - t0) / (2.0 * passes * hand_edges), note);
+    snprintf(note, sizeof(note), "\"12:34\", %u edges", text_edges);
+    report("fctx_draw_string", "ns/edge", (double)(t2 - t1) / (2.0 * passes * text_edges), note);
+    report("fctx_draw_string", "ns/string", (double)(t2 - t1) / (2.0 * passes), NULL);
+    report("fctx_draw_layout", "ns/string", (double)(t3 - t2) / (2.0 * passes), NULL);
+    fctx_begin_fill(&b->fctx);
+    uint32_t checksum = hands_checksum(b, NULL, NULL);
+    report("fctx_draw_decoded_path", "ns/edge", (double)(t4 - t3) / (2.0 * passes * hand_edges),
+           check(hands_checksum(b, decoded, NULL) == checksum, "matches commands"));
+    report("fctx_draw_commands_cached", "ns/edge", (double)(t5 - t4) / (2.0 * passes * hand_edges),
+           check(hands_checksum(b, NULL, caches) == checksum, "matches commands"));
+    fpath_decoded_destroy(decoded);
+    fedge_cache_destroy(caches[0]);
+    fedge_cache_destroy(caches[1]);
+    fctx_begin_fill(&b->fctx);
+}
+
+/* Animated hands, re-flattened every frame or flattened once in path space
+ * at the largest scale they are drawn at.
+ */
+static void bench_flattened_path(Bench* b) {
+    FDecodedPath* flat = fpath_flatten(b->hand->data, b->hand->size, FPointOne, FPointOne);
+
+    uint32_t passes = 200 * s_repeat;
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        draw_hands(b, pass * TRIG_MAX_ANGLE / 60);
+        draw_hands(b, pass * TRIG_MAX_ANGLE / 60);
+    }
+    uint64_t t1 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        draw_hands_with(b, pass * TRIG_MAX_ANGLE / 60, flat, NULL);
+        draw_hands_with(b, pass * TRIG_MAX_ANGLE / 60, flat, NULL);
+    }
+    uint64_t t2 = now_ns();
+
+    char note[64];
+    report("rotating hands (commands)", "ns/draw", (double)(t1 - t0) / (2.0 * passes), NULL);
+    snprintf(note, sizeof(note), "%u points", flat->point_count);
+    report("rotating hands (flattened)", "ns/draw", (double)(t2 - t1) / (2.0 * passes), note);
+    fpath_decoded_destroy(flat);
+    fctx_begin_fill(&b->fctx);
+}
+
+/* The hand path re-encoded in the compact format, which should decode to
+ * exactly the same points.
+ */
+static void bench_compact_path(Bench* b) {
+    FPath* legacy = b->hand;
+    uint8_t data[sizeof(FPath) + 256];
+    FPath* compact = (FPath*)data;
+    compact->size = fpath_encode_compact(legacy->data, legacy->size, compact->data, 256);
+
+    FDecodedPath* a = fpath_decode(legacy->data, legacy->size);
+    FDecodedPath* c = fpath_decode(compact->data, compact->size);
+    bool match = a && c && a->op_count == c->op_count && a->point_count == c->point_count
+        && memcmp(a->ops, c->ops, a->op_count) == 0
+        && memcmp(a->points, c->points, a->point_count * sizeof(FPoint)) == 0;
+    fpath_decoded_destroy(a);
+    fpath_decoded_destroy(c);
+
+    uint32_t passes = 200 * s_repeat;
+    uint64_t t0 = now_ns();
+    b->hand = compact;
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        draw_hands(b, TRIG_MAX_ANGLE / 8);
+        draw_hands(b, TRIG_MAX_ANGLE / 8);
+    }
+    uint64_t t1 = now_ns();
+    b->hand = legacy;
+
+    char note[64];
+    snprintf(note, sizeof(note), "%u -> %u bytes, %s", legacy->size, compact->size,
+             check(match, "matches commands"));
+    report("fctx_draw_commands (compact)", "ns/draw", (double)(t1 - t0) / (2.0 * passes), note);
+    fctx_begin_fill(&b->fctx);
+}
+
+/* Small polygons through fctx_draw_path, with the point buffer taken from
+ * the scratch arena and from the heap.
+ */
+static void bench_draw_path(Bench* b) {
+    FPoint tick[4] = {
+        FPointI(-1, 0), FPointI(1, 0), FPointI(1, 6), FPointI(-1, 6)
+    };
+    fctx_set_offset(&b->fctx, FPointI(b->size.w / 2, b->size.h / 2));
+    fctx_set_scale(&b->fctx, FPointOne, FPointOne);
+    fctx_set_rotation(&b->fctx, 0);
+
+    uint32_t passes = 5000 * s_repeat;
+    uint64_t elapsed[2];
+    for (int heap = 0; heap < 2; ++heap) {
+        if (heap) fctx_set_scratch_size(&b->fctx, 0);
+        uint64_t t0 = now_ns();
+        for (uint32_t pass = 0; pass < passes; ++pass) {
+            fctx_draw_path(&b->fctx, tick, 4);
+            fctx_draw_path(&b->fctx, tick, 4);
+        }
+        elapsed[heap] = now_ns() - t0;
+    }
+    fctx_set_scratch_size(&b->fctx, 256);
+    report("fctx_draw_path (scratch)", "ns/path", (double)elapsed[0] / (2.0 * passes), "4 points");
+    report("fctx_draw_path (heap)", "ns/path", (double)elapsed[1] / (2.0 * passes), "4 points");
+    fctx_begin_fill(&b->fctx);
+}
+
+static void bench_end_fill(Bench* b) {
+    uint32_t passes = 100 * s_repeat;
+    uint64_t elapsed = 0;
+    uint64_t pixels = 0;
+    FPoint center = FPointI(b->size.w / 2, b->size.h / 2);
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        fctx_begin_fill(&b->fctx);
+        fctx_plot_circle(&b->fctx, &center, INT_TO_FIXED(b->size.w / 2));
+        fctx_plot_circle(&b->fctx, &center, INT_TO_FIXED(b->size.w / 2 - 6));
+        pixels += resolve_pixels(b);
+        uint64_t t0 = now_ns();
+        fctx_end_fill(&b->fctx);
+        elapsed += now_ns() - t0;
+    }
+    report("fctx_end_fill", "ns/pixel", (double)elapsed / pixels, "full-screen dial ring");
+
+    elapsed = 0;
+    pixels = 0;
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        fctx_begin_fill(&b->fctx);
+        draw_clock_text(b);
+        pixels += resolve_pixels(b);
+        uint64_t t0 = now_ns();
+        fctx_end_fill(&b->fctx);
+        elapsed += now_ns() - t0;
+    }
+    report("fctx_end_fill", "ns/pixel", (double)elapsed / pixels, "clock text");
+}
+
+/* A complete watch face: dial ring, 60 tick marks, clock text and hands. */
+static void draw_frame(Bench* b, uint32_t minute_angle) {
+    FContext* fctx = &b->fctx;
+    FPoint center = FPointI(b->size.w / 2, b->size.h / 2);
+    fixed_t radius = INT_TO_FIXED((b->size.w < b->size.h ? b->size.w : b->size.h) / 2);
+
+    fctx_begin_fill(fctx);
+    fctx_set_fill_color(fctx, GColorDarkGray);
+    fctx_plot_circle(fctx, &center, radius);
+    fctx_plot_circle(fctx, &center, radius - INT_TO_FIXED(4));
+    fctx_end_fill(fctx);
+
+    FPoint tick[4] = {
+        FPointI(-1, 0), FPointI(1, 0), FPointI(1, 6), FPointI(-1, 6)
+    };
+    fctx_begin_fill(fctx);
+    fctx_set_fill_color(fctx, GColorWhite);
+    fctx_set_offset(fctx, center);
+    fctx_set_scale(fctx, FPointOne, FPointOne);
+    fctx_set_pivot(fctx, FPoint(0, radius - INT_TO_FIXED(4)));
+    for (int k = 0; k < 60; ++k) {
+        fctx_set_rotation(fctx, k * TRIG_MAX_ANGLE / 60);
+        fctx_draw_path(fctx, tick, 4);
+    }
+    fctx_set_pivot(fctx, FPointZero);
+    fctx_end_fill(fctx);
+
+    fctx_begin_fill(fctx);
+    fctx_set_fill_color(fctx, GColorLightGray);
+    draw_clock_text(b);
+    fctx_end_fill(fctx);
+
+    fctx_begin_fill(fctx);
+    fctx_set_fill_color(fctx, GColorRed);
+    draw_hands(b, minute_angle);
+    fctx_plot_circle(fctx, &center, INT_TO_FIXED(5));
+    fctx_end_fill(fctx);
+}
+
+static void bench_frame(Bench* b) {
+    clear_frame(b);
+    draw_frame(b, TRIG_MAX_ANGLE / 8);
+    b->frame_checksum = frame_checksum(b);
+
+    uint32_t passes = 100 * s_repeat;
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        draw_frame(b, pass * TRIG_MAX_ANGLE / 60);
+    }
+    uint64_t t1 = now_ns();
+    char note[64];
+    snprintf(note, sizeof(note), "checksum %08x", b->frame_checksum);
+    report("frame", "us/frame", (double)(t1 - t0) / (1000.0 * passes), note);
+
+    /* The same frame with all four fills in one frame buffer session. */
+    clear_frame(b);
+    fctx_begin_frame(&b->fctx);
+    draw_frame(b, TRIG_MAX_ANGLE / 8);
+    fctx_end_frame(&b->fctx);
+    uint32_t checksum = frame_checksum(b);
+
+    t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        fctx_begin_frame(&b->fctx);
+        draw_frame(b, pass * TRIG_MAX_ANGLE / 60);
+        fctx_end_frame(&b->fctx);
+    }
+    t1 = now_ns();
+    report("frame (session)", "us/frame", (double)(t1 - t0) / (1000.0 * passes),
+           check(checksum == b->frame_checksum, "matches frame"));
+}
+
+/* Per-frame context setup: a fresh init and deinit, against rebinding two
+ * persistent contexts that share one pooled flag buffer.  The frame drawn
+ * with a persistent context should match the regular frame checksum.
+ */
+static void bench_persistent_context(Bench* b) {
+    uint32_t passes = 100 * s_repeat;
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        FContext fctx;
+        fctx_init_context(&fctx, b->gctx);
+        fctx_deinit_context(&fctx);
+    }
+    uint64_t t1 = now_ns();
+    FContext layers[2];
+    memset(layers, 0, sizeof(layers));
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        fctx_bind_context(&layers[0], b->gctx);
+        fctx_bind_context(&layers[1], b->gctx);
+    }
+    uint64_t t2 = now_ns();
+    bool shared = layers[0].flag_buffer == layers[1].flag_buffer;
+
+    FContext fctx = b->fctx;
+    b->fctx = layers[1];
+    clear_frame(b);
+    draw_frame(b, TRIG_MAX_ANGLE / 8);
+    uint32_t checksum = frame_checksum(b);
+    layers[1] = b->fctx;
+    b->fctx = fctx;
+    fctx_deinit_context(&layers[0]);
+    fctx_deinit_context(&layers[1]);
+
+    char note[64];
+    report("fctx_init_context + deinit", "ns/frame", (double)(t1 - t0) / passes, NULL);
+    snprintf(note, sizeof(note), "%s, %s", check(shared, "shared"),
+             check(checksum == b->frame_checksum, "matches frame"));
+    report("fctx_bind_context x2", "ns/frame", (double)(t2 - t1) / passes, note);
+}
+
+/* A long string scrolled so that most of it is off screen, as for a
+ * marquee.  A font loaded into a buffer has no glyph bounds, so its glyphs
+ * are culled by cell instead; the checksums should match.
+ */
+static void draw_marquee(Bench* b, FFont* font) {
+    fctx_set_offset(&b->fctx, FPointI(-300, b->size.h / 2));
+    fctx_set_rotation(&b->fctx, 0);
+    fctx_set_text_em_height(&b->fctx, font, 40);
+    fctx_draw_string(&b->fctx, "0123456789:0123456789:0123456789", font, GTextAlignmentLeft, FTextAnchorCapMiddle);
+}
+
+static void bench_marquee(Bench* b) {
+    FFont* fonts[2];
+    fonts[0] = b->font;
+    ResHandle rh = resource_get_handle(RESOURCE_ID_BENCH_FONT);
+    fonts[1] = ffont_load_from_resource_into_buffer(RESOURCE_ID_BENCH_FONT, malloc(resource_size(rh)));
+
+    uint32_t checksums[2];
+    uint64_t elapsed[2];
+    uint32_t passes = 200 * s_repeat;
+    for (int k = 0; k < 2; ++k) {
+        clear_frame(b);
+        fctx_begin_fill(&b->fctx);
+        draw_marquee(b, fonts[k]);
+        fctx_end_fill(&b->fctx);
+        checksums[k] = frame_checksum(b);
+
+        uint64_t t0 = now_ns();
+        for (uint32_t pass = 0; pass < passes; ++pass) {
+            draw_marquee(b, fonts[k]);
+            draw_marquee(b, fonts[k]);
+        }
+        elapsed[k] = now_ns() - t0;
+    }
+    free(fonts[1]);
+
+    /* The same, four times over as a layout, which can search for the first
+     * visible glyph. */
+    FTextLayout* layout = ftext_layout_create(
+        "0123456789:0123456789:0123456789" "0123456789:0123456789:0123456789"
+        "0123456789:0123456789:0123456789" "0123456789:0123456789:0123456789",
+        b->font, GTextAlignmentLeft, FTextAnchorCapMiddle);
+    fctx_set_offset(&b->fctx, FPointI(-1500, b->size.h / 2));
+    clear_frame(b);
+    fctx_begin_fill(&b->fctx);
+    fctx_draw_layout(&b->fctx, layout);
+    fctx_end_fill(&b->fctx);
+    uint32_t layout_checksum = frame_checksum(b);
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        fctx_draw_layout(&b->fctx, layout);
+        fctx_draw_layout(&b->fctx, layout);
+    }
+    uint64_t layout_elapsed = now_ns() - t0;
+    ftext_layout_destroy(layout);
+
+    char note[64];
+    snprintf(note, sizeof(note), "32 glyphs, checksum %08x", checksums[0]);
+    report("fctx_draw_string (marquee)", "ns/string", (double)elapsed[0] / (2.0 * passes), note);
+    snprintf(note, sizeof(note), "no bounds, %s", check(checksums[1] == checksums[0], "matches bounds"));
+    report("fctx_draw_string (marquee)", "ns/string", (double)elapsed[1] / (2.0 * passes), note);
+    snprintf(note, sizeof(note), "128 glyphs, checksum %08x", layout_checksum);
+    report("fctx_draw_layout (marquee)", "ns/string", (double)layout_elapsed / (2.0 * passes), note);
+    fctx_begin_fill(&b->fctx);
+}
+
+/* String drawing with a paged font whose glyph cache holds every glyph in
+ * the string, so this measures the cost of cache lookups after warm up.
+ */
+static void bench_paged_font(Bench* b) {
+    FFont* font = b->font;
+    b->font = ffont_create_paged_from_resource(RESOURCE_ID_BENCH_FONT, 1500);
+
+    uint32_t passes = 200 * s_repeat;
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        draw_clock_text(b);
+        draw_clock_text(b);
+    }
+    uint64_t t1 = now_ns();
+
+    uint32_t hits, misses;
+    ffont_cache_stats(b->font, &hits, &misses);
+    char note[64];
+    snprintf(note, sizeof(note), "%u hits, %u misses", hits, misses);
+    report("fctx_draw_string (paged)", "ns/string", (double)(t1 - t0) / (2.0 * passes), note);
+
+    ffont_destroy(b->font);
+    b->font = font;
+}
+
+/* Frame time with a banded flag buffer.  The checksum should match the
+ * unbanded frame.
+ */
+static void bench_banded_frame(Bench* b, int16_t rows) {
+    fctx_deinit_context(&b->fctx);
+    fctx_init_context_banded(&b->fctx, b->gctx, rows);
+
+    clear_frame(b);
+    draw_frame(b, TRIG_MAX_ANGLE / 8);
+    uint32_t checksum = frame_checksum(b);
+
+    uint32_t passes = 100 * s_repeat;
+    uint64_t t0 = now_ns();
+    for (uint32_t pass = 0; pass < passes; ++pass) {
+        draw_frame(b, pass * TRIG_MAX_ANGLE / 60);
+    }
+    uint64_t t1 = now_ns();
+    char name[32];
+    snprintf(name, sizeof(name), "frame (band %d)", rows);
+    report(name, "us/frame", (double)(t1 - t0) / (1000.0 * passes),
+           check(checksum == b->frame_checksum, "matches frame"));
+}
+
+static void run(const char* platform, const char* mode) {
+    Bench b;
+    memset(&b, 0, sizeof(b));
+    b.gctx = host_graphics_context_create();
+    b.size = GSize(PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT);
+    b.font = ffont_create_from_resource(RESOURCE_ID_BENCH_FONT);
+    b.hand = fpath_create_from_resource(RESOURCE_ID_BENCH_HAND);
+    s_rand_state = 12345;
+
+    printf("%s %dx%d %s\n", platform, b.size.w, b.size.h, mode);
+    fctx_init_context(&b.fctx, b.gctx);
+    fctx_set_fill_color(&b.fctx, GColorWhite);
+    fctx_set_color_bias(&b.fctx, 0);
+    fctx_begin_fill(&b.fctx);
+
+    bench_plot_edge(&b);
+    bench_plot_circle(&b);
+    bench_plot_arc(&b);
+    bench_plot_ellipse(&b);
+    bench_bezier(&b);
+    bench_draw_commands(&b);
+    bench_flattened_path(&b);
+    bench_compact_path(&b);
+    bench_draw_path(&b);
+    bench_marquee(&b);
+    bench_paged_font(&b);
+    bench_end_fill(&b);
+    bench_frame(&b);
+    bench_persistent_context(&b);
+    bench_banded_frame(&b, 32);
+    bench_banded_frame(&b, 8);
+
+    fctx_deinit_context(&b.fctx);
+    fpath_destroy(b.hand);
+    ffont_destroy(b.font);
+    host_graphics_context_destroy(b.gctx);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        s_repeat = (uint32_t)atoi(argv[1]);
+        if (s_repeat == 0) s_repeat = 1;
+    }
+    build_font_resource();
+    build_hand_resource();
+
+#ifdef PBL_COLOR
+    fctx_enable_aa(true);
+    run(BENCH_PLATFORM, "AA");
+    fctx_enable_aa(false);
+    run(BENCH_PLATFORM, "BW");
+#else
+    run(BENCH_PLATFORM, "BW");
+#endif
+
+    free(s_font_data);
+    free(s_hand_data);
+    return s_failures ? 1 : 0;
+}
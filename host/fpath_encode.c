@@ -0,0 +1,51 @@
+#include "pebble.h"
+#include "fctx.h"
+#include "fpath_encoder.h"
+
+/*
+ * Converts a compiled path resource to the compact path format.
+ *
+ * usage: fpath_encode <input> <output>
+ */
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <input> <output>\n", argv[0]);
+        return 2;
+    }
+
+    static uint8_t input[UINT16_MAX + 1];
+    static uint8_t output[UINT16_MAX];
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    size_t length = fread(input, 1, sizeof(input), in);
+    fclose(in);
+    if (length > UINT16_MAX) {
+        fprintf(stderr, "%s: path data is too long\n", argv[1]);
+        return 1;
+    }
+
+    if (fpath_is_compact(input, (uint16_t)length)) {
+        fprintf(stderr, "%s: already in the compact format\n", argv[1]);
+        return 1;
+    }
+
+    uint16_t encoded = fpath_encode_compact(input, (uint16_t)length, output, sizeof(output));
+    if (encoded == 0) {
+        fprintf(stderr, "%s: could not encode path data\n", argv[1]);
+        return 1;
+    }
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out || fwrite(output, 1, encoded, out) != encoded) {
+        perror(argv[2]);
+        if (out) fclose(out);
+        return 1;
+    }
+    fclose(out);
+    printf("%s: %u bytes -> %u bytes\n", argv[2], (unsigned)length, (unsigned)encoded);
+    return 0;
+}
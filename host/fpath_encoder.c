@@ -0,0 +1,96 @@
+#include "pebble.h"
+#include "fctx.h"
+#include "fpath_encoder.h"
+
+typedef struct Encoder {
+    uint8_t* data;
+    uint16_t length;
+    uint16_t capacity;
+    bool overflow;
+} Encoder;
+
+static void encode_byte(Encoder* e, uint8_t byte) {
+    if (e->length < e->capacity) {
+        e->data[e->length++] = byte;
+    } else {
+        e->overflow = true;
+    }
+}
+
+/* Coordinates are stored relative to origin, wrapping as fixed16_t. */
+static void encode_coord(Encoder* e, int32_t value, int32_t origin) {
+    int16_t delta = (int16_t)(uint16_t)(value - origin);
+    if (delta > FPATH_COMPACT_ESCAPE && delta <= INT8_MAX) {
+        encode_byte(e, (uint8_t)(int8_t)delta);
+    } else {
+        encode_byte(e, (uint8_t)(int8_t)FPATH_COMPACT_ESCAPE);
+        encode_byte(e, (uint8_t)((uint16_t)delta & 0xff));
+        encode_byte(e, (uint8_t)((uint16_t)delta >> 8));
+    }
+}
+
+uint16_t fpath_encode_compact(const void* path_data, uint16_t length, uint8_t* out, uint16_t capacity) {
+
+    Encoder e = { out, 0, capacity, false };
+    encode_byte(&e, FPATH_COMPACT_MAGIC);
+    encode_byte(&e, FPATH_COMPACT_VERSION);
+
+    int32_t initx = 0, inity = 0;
+    int32_t curx = 0, cury = 0;
+    const uint8_t* data = path_data;
+    const uint8_t* end = data + length;
+    while (data < end) {
+        if (end - data < 2) {
+            return 0;
+        }
+        uint16_t code = (uint16_t)(data[0] | (data[1] << 8));
+        data += 2;
+
+        /* Parameter count, and whether the parameters are x, y pairs or
+         * a single x (H) or y (V) coordinate.
+         */
+        int pcount;
+        switch (code) {
+            case 'Z': pcount = 0; break;
+            case 'H': case 'V': pcount = 1; break;
+            case 'M': case 'L': case 'T': pcount = 2; break;
+            case 'Q': case 'S': pcount = 4; break;
+            case 'C': pcount = 6; break;
+            default:
+                fprintf(stderr, "invalid draw command %d\n", code);
+                return 0;
+        }
+        if (end - data < 2 * pcount) {
+            return 0;
+        }
+        int16_t params[6];
+        for (int k = 0; k < pcount; ++k) {
+            params[k] = (int16_t)(data[0] | (data[1] << 8));
+            data += 2;
+        }
+
+        encode_byte(&e, (uint8_t)code);
+        if (code == 'H') {
+            encode_coord(&e, params[0], curx);
+            curx = params[0];
+        } else if (code == 'V') {
+            encode_coord(&e, params[0], cury);
+            cury = params[0];
+        } else if (code == 'Z') {
+            curx = initx;
+            cury = inity;
+        } else {
+            for (int k = 0; k < pcount; k += 2) {
+                encode_coord(&e, params[k], curx);
+                encode_coord(&e, params[k + 1], cury);
+            }
+            curx = params[pcount - 2];
+            cury = params[pcount - 1];
+            if (code == 'M') {
+                initx = curx;
+                inity = cury;
+            }
+        }
+    }
+    return e.overflow ? 0 : e.length;
+}
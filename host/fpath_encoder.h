@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Re-encodes a compiled path command stream (as written by fctx-compiler)
+ * in the compact format described in fctx.h.  Returns the encoded length,
+ * or 0 if the input is malformed or does not fit in capacity bytes.
+ */
+uint16_t fpath_encode_compact(const void* path_data, uint16_t length, uint8_t* out, uint16_t capacity);
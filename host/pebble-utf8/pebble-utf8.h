@@ -0,0 +1,8 @@
+#pragma once
+#include "pebble.h"
+
+/*
+ * Host stand-in for the pebble-utf8 package.  Feed one byte at a time;
+ * returns 0 when a complete code point has been decoded into code_point.
+ */
+uint16_t utf8_decode_byte(uint8_t byte, uint16_t* state, uint16_t* code_point);
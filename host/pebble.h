@@ -0,0 +1,184 @@
+#pragma once
+
+/*
+ * Minimal stand-in for the Pebble SDK header, sufficient to build the fctx
+ * sources on a host machine.  Only the types and functions used by the
+ * library are provided.  Platform characteristics are selected with the
+ * usual SDK defines (PBL_COLOR / PBL_BW, PBL_RECT / PBL_ROUND) plus
+ * PBL_DISPLAY_WIDTH and PBL_DISPLAY_HEIGHT.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(PBL_COLOR) && !defined(PBL_BW)
+#define PBL_COLOR
+#endif
+
+#if !defined(PBL_RECT) && !defined(PBL_ROUND)
+#define PBL_RECT
+#endif
+
+#ifndef PBL_DISPLAY_WIDTH
+#ifdef PBL_ROUND
+#define PBL_DISPLAY_WIDTH 180
+#else
+#define PBL_DISPLAY_WIDTH 144
+#endif
+#endif
+
+#ifndef PBL_DISPLAY_HEIGHT
+#ifdef PBL_ROUND
+#define PBL_DISPLAY_HEIGHT 180
+#else
+#define PBL_DISPLAY_HEIGHT 168
+#endif
+#endif
+
+// -----------------------------------------------------------------------------
+// Logging.
+// -----------------------------------------------------------------------------
+
+typedef enum {
+    APP_LOG_LEVEL_ERROR = 1,
+    APP_LOG_LEVEL_WARNING = 50,
+    APP_LOG_LEVEL_INFO = 100,
+    APP_LOG_LEVEL_DEBUG = 200,
+    APP_LOG_LEVEL_DEBUG_VERBOSE = 255,
+} AppLogLevel;
+
+void app_log(uint8_t log_level, const char* src_filename, int src_line_number, const char* fmt, ...);
+#define APP_LOG(level, fmt, args...) app_log(level, __FILE__, __LINE__, fmt, ## args)
+
+// -----------------------------------------------------------------------------
+// Geometry and color.
+// -----------------------------------------------------------------------------
+
+typedef struct GPoint {
+    int16_t x;
+    int16_t y;
+} GPoint;
+#define GPoint(x, y) ((GPoint){(x), (y)})
+#define GPointZero GPoint(0, 0)
+
+typedef struct GSize {
+    int16_t w;
+    int16_t h;
+} GSize;
+#define GSize(w, h) ((GSize){(w), (h)})
+
+typedef struct GRect {
+    GPoint origin;
+    GSize size;
+} GRect;
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+
+typedef union GColor8 {
+    uint8_t argb;
+    struct {
+        uint8_t b:2;
+        uint8_t g:2;
+        uint8_t r:2;
+        uint8_t a:2;
+    };
+} GColor8;
+typedef GColor8 GColor;
+
+#define GColorBlackARGB8 ((uint8_t)0b11000000)
+#define GColorWhiteARGB8 ((uint8_t)0b11111111)
+#define GColorRedARGB8 ((uint8_t)0b11110000)
+#define GColorGreenARGB8 ((uint8_t)0b11001100)
+#define GColorBlueARGB8 ((uint8_t)0b11000011)
+#define GColorLightGrayARGB8 ((uint8_t)0b11101010)
+#define GColorDarkGrayARGB8 ((uint8_t)0b11010101)
+#define GColorClearARGB8 ((uint8_t)0b00000000)
+
+#define GColorBlack ((GColor8){.argb = GColorBlackARGB8})
+#define GColorWhite ((GColor8){.argb = GColorWhiteARGB8})
+#define GColorRed ((GColor8){.argb = GColorRedARGB8})
+#define GColorGreen ((GColor8){.argb = GColorGreenARGB8})
+#define GColorBlue ((GColor8){.argb = GColorBlueARGB8})
+#define GColorLightGray ((GColor8){.argb = GColorLightGrayARGB8})
+#define GColorDarkGray ((GColor8){.argb = GColorDarkGrayARGB8})
+#define GColorClear ((GColor8){.argb = GColorClearARGB8})
+
+static inline bool gcolor_equal(GColor8 x, GColor8 y) {
+    return x.argb == y.argb;
+}
+
+typedef enum {
+    GTextAlignmentLeft,
+    GTextAlignmentCenter,
+    GTextAlignmentRight,
+} GTextAlignment;
+
+// -----------------------------------------------------------------------------
+// Bitmaps and the graphics context.
+// -----------------------------------------------------------------------------
+
+typedef enum GBitmapFormat {
+    GBitmapFormat1Bit = 0,
+    GBitmapFormat8Bit,
+    GBitmapFormat1BitPalette,
+    GBitmapFormat2BitPalette,
+    GBitmapFormat4BitPalette,
+    GBitmapFormat8BitCircular,
+} GBitmapFormat;
+
+typedef struct GBitmap GBitmap;
+typedef struct GContext GContext;
+
+typedef struct GBitmapDataRowInfo {
+    uint8_t* data;
+    int16_t min_x;
+    int16_t max_x;
+} GBitmapDataRowInfo;
+
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format);
+void gbitmap_destroy(GBitmap* bitmap);
+GRect gbitmap_get_bounds(const GBitmap* bitmap);
+GBitmapFormat gbitmap_get_format(const GBitmap* bitmap);
+uint8_t* gbitmap_get_data(const GBitmap* bitmap);
+uint16_t gbitmap_get_bytes_per_row(const GBitmap* bitmap);
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap* bitmap, uint16_t y);
+
+GBitmap* graphics_capture_frame_buffer(GContext* ctx);
+bool graphics_release_frame_buffer(GContext* ctx, GBitmap* buffer);
+
+// -----------------------------------------------------------------------------
+// Resources.
+// -----------------------------------------------------------------------------
+
+typedef void* ResHandle;
+
+ResHandle resource_get_handle(uint32_t resource_id);
+size_t resource_size(ResHandle h);
+size_t resource_load(ResHandle h, uint8_t* buffer, size_t max_length);
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t* buffer, size_t num_bytes);
+
+// -----------------------------------------------------------------------------
+// Trigonometry.
+// -----------------------------------------------------------------------------
+
+#define TRIG_MAX_RATIO 0xffff
+#define TRIG_MAX_ANGLE 0x10000
+#define DEG_TO_TRIGANGLE(angle) (((angle) * TRIG_MAX_ANGLE) / 360)
+
+int32_t sin_lookup(int32_t angle);
+int32_t cos_lookup(int32_t angle);
+int32_t atan2_lookup(int16_t y, int16_t x);
+
+// -----------------------------------------------------------------------------
+// Host-only extensions, not part of the Pebble SDK.
+// -----------------------------------------------------------------------------
+
+// Create a graphics context with a frame buffer matching the configured platform.
+GContext* host_graphics_context_create(void);
+void host_graphics_context_destroy(GContext* ctx);
+
+// Register an in-memory blob to be served by the resource_* functions.
+void host_resource_register(uint32_t resource_id, const void* data, size_t size);
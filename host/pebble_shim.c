@@ -0,0 +1,273 @@
+#include "pebble.h"
+#include "pebble-utf8/pebble-utf8.h"
+#include <math.h>
+#include <stdarg.h>
+
+// -----------------------------------------------------------------------------
+// Logging.
+// -----------------------------------------------------------------------------
+
+void app_log(uint8_t log_level, const char* src_filename, int src_line_number, const char* fmt, ...) {
+    if (log_level > APP_LOG_LEVEL_WARNING) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s:%d ", src_filename, src_line_number);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+// -----------------------------------------------------------------------------
+// Bitmaps.
+// -----------------------------------------------------------------------------
+
+struct GBitmap {
+    uint8_t* data;
+    uint16_t row_size_bytes;
+    GBitmapFormat format;
+    GRect bounds;
+    GBitmapDataRowInfo* rows;
+};
+
+/* The circular frame buffer stores only the visible pixels of each row,
+ * packed back to back.  The row info data pointer is biased by -min_x so
+ * that it may be indexed directly by x.
+ */
+static void circular_row_extents(GSize size, int16_t y, int16_t* min_x, int16_t* max_x) {
+    int32_t r = size.w / 2;
+    int32_t dy = 2 * y + 1 - size.h;
+    int32_t half = (int32_t)sqrt((double)(4 * r * r - dy * dy)) / 2;
+    if (half > r) half = r;
+    *min_x = r - half;
+    *max_x = r + half - 1;
+}
+
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format) {
+    GBitmap* bitmap = calloc(1, sizeof(GBitmap));
+    if (!bitmap) {
+        return NULL;
+    }
+    bitmap->format = format;
+    bitmap->bounds = GRect(0, 0, size.w, size.h);
+    bitmap->rows = calloc(size.h, sizeof(GBitmapDataRowInfo));
+
+    size_t data_size;
+    if (format == GBitmapFormat8BitCircular) {
+        bitmap->row_size_bytes = 0;
+        data_size = 0;
+        for (int16_t y = 0; y < size.h; ++y) {
+            int16_t min_x, max_x;
+            circular_row_extents(size, y, &min_x, &max_x);
+            data_size += max_x - min_x + 1;
+        }
+    } else if (format == GBitmapFormat8Bit) {
+        bitmap->row_size_bytes = size.w;
+        data_size = (size_t)size.w * size.h;
+    } else {
+        bitmap->row_size_bytes = ((size.w + 31) / 32) * 4;
+        data_size = (size_t)bitmap->row_size_bytes * size.h;
+    }
+    bitmap->data = calloc(data_size ? data_size : 1, 1);
+    if (!bitmap->rows || !bitmap->data) {
+        gbitmap_destroy(bitmap);
+        return NULL;
+    }
+
+    size_t offset = 0;
+    for (int16_t y = 0; y < size.h; ++y) {
+        GBitmapDataRowInfo* row = bitmap->rows + y;
+        if (format == GBitmapFormat8BitCircular) {
+            circular_row_extents(size, y, &row->min_x, &row->max_x);
+            row->data = bitmap->data + offset - row->min_x;
+            offset += row->max_x - row->min_x + 1;
+        } else {
+            row->data = bitmap->data + (size_t)y * bitmap->row_size_bytes;
+            row->min_x = 0;
+            row->max_x = size.w - 1;
+        }
+    }
+    return bitmap;
+}
+
+void gbitmap_destroy(GBitmap* bitmap) {
+    if (bitmap) {
+        free(bitmap->data);
+        free(bitmap->rows);
+        free(bitmap);
+    }
+}
+
+GRect gbitmap_get_bounds(const GBitmap* bitmap) {
+    return bitmap->bounds;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap* bitmap) {
+    return bitmap->format;
+}
+
+uint8_t* gbitmap_get_data(const GBitmap* bitmap) {
+    return bitmap->data;
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap* bitmap) {
+    return bitmap->row_size_bytes;
+}
+
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap* bitmap, uint16_t y) {
+    return bitmap->rows[y];
+}
+
+// -----------------------------------------------------------------------------
+// Graphics context.
+// -----------------------------------------------------------------------------
+
+struct GContext {
+    GBitmap* frame_buffer;
+    bool captured;
+};
+
+GContext* host_graphics_context_create(void) {
+    GContext* ctx = calloc(1, sizeof(GContext));
+    if (ctx) {
+#if defined(PBL_BW)
+        GBitmapFormat format = GBitmapFormat1Bit;
+#elif defined(PBL_ROUND)
+        GBitmapFormat format = GBitmapFormat8BitCircular;
+#else
+        GBitmapFormat format = GBitmapFormat8Bit;
+#endif
+        ctx->frame_buffer = gbitmap_create_blank(GSize(PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT), format);
+    }
+    return ctx;
+}
+
+void host_graphics_context_destroy(GContext* ctx) {
+    if (ctx) {
+        gbitmap_destroy(ctx->frame_buffer);
+        free(ctx);
+    }
+}
+
+GBitmap* graphics_capture_frame_buffer(GContext* ctx) {
+    if (ctx->captured) {
+        return NULL;
+    }
+    ctx->captured = true;
+    return ctx->frame_buffer;
+}
+
+bool graphics_release_frame_buffer(GContext* ctx, GBitmap* buffer) {
+    if (!ctx->captured || buffer != ctx->frame_buffer) {
+        return false;
+    }
+    ctx->captured = false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Resources.
+// -----------------------------------------------------------------------------
+
+typedef struct HostResource {
+    uint32_t id;
+    const uint8_t* data;
+    size_t size;
+} HostResource;
+
+#define HOST_RESOURCE_MAX 32
+static HostResource s_resources[HOST_RESOURCE_MAX];
+static uint32_t s_resource_count;
+
+void host_resource_register(uint32_t resource_id, const void* data, size_t size) {
+    for (uint32_t k = 0; k < s_resource_count; ++k) {
+        if (s_resources[k].id == resource_id) {
+            s_resources[k].data = data;
+            s_resources[k].size = size;
+            return;
+        }
+    }
+    if (s_resource_count < HOST_RESOURCE_MAX) {
+        s_resources[s_resource_count++] = (HostResource){resource_id, data, size};
+    }
+}
+
+ResHandle resource_get_handle(uint32_t resource_id) {
+    for (uint32_t k = 0; k < s_resource_count; ++k) {
+        if (s_resources[k].id == resource_id) {
+            return &s_resources[k];
+        }
+    }
+    return NULL;
+}
+
+size_t resource_size(ResHandle h) {
+    return h ? ((HostResource*)h)->size : 0;
+}
+
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t* buffer, size_t num_bytes) {
+    HostResource* res = (HostResource*)h;
+    if (!res || start_offset >= res->size) {
+        return 0;
+    }
+    if (num_bytes > res->size - start_offset) {
+        num_bytes = res->size - start_offset;
+    }
+    memcpy(buffer, res->data + start_offset, num_bytes);
+    return num_bytes;
+}
+
+size_t resource_load(ResHandle h, uint8_t* buffer, size_t max_length) {
+    return resource_load_byte_range(h, 0, buffer, max_length);
+}
+
+// -----------------------------------------------------------------------------
+// Trigonometry.
+// -----------------------------------------------------------------------------
+
+static const double k_two_pi = 6.283185307179586;
+
+int32_t sin_lookup(int32_t angle) {
+    return (int32_t)lround(sin(angle * (k_two_pi / TRIG_MAX_ANGLE)) * TRIG_MAX_RATIO);
+}
+
+int32_t cos_lookup(int32_t angle) {
+    return (int32_t)lround(cos(angle * (k_two_pi / TRIG_MAX_ANGLE)) * TRIG_MAX_RATIO);
+}
+
+int32_t atan2_lookup(int16_t y, int16_t x) {
+    double a = atan2((double)y, (double)x);
+    if (a < 0) {
+        a += k_two_pi;
+    }
+    return (int32_t)(a * (TRIG_MAX_ANGLE / k_two_pi)) % TRIG_MAX_ANGLE;
+}
+
+// -----------------------------------------------------------------------------
+// UTF-8 (pebble-utf8 package).
+// -----------------------------------------------------------------------------
+
+uint16_t utf8_decode_byte(uint8_t byte, uint16_t* state, uint16_t* code_point) {
+    if (*state == 0) {
+        if (byte < 0x80) {
+            *code_point = byte;
+        } else if ((byte & 0xE0) == 0xC0) {
+            *code_point = byte & 0x1F;
+            *state = 1;
+        } else if ((byte & 0xF0) == 0xE0) {
+            *code_point = byte & 0x0F;
+            *state = 2;
+        } else {
+            *code_point = 0xFFFD;
+            *state = (byte & 0xF8) == 0xF0 ? 3 : 0;
+        }
+    } else if ((byte & 0xC0) == 0x80) {
+        *code_point = (uint16_t)((*code_point << 6) | (byte & 0x3F));
+        --*state;
+    } else {
+        *code_point = 0xFFFD;
+        *state = 0;
+    }
+    return *state;
+}
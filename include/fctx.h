@@ -12,6 +12,9 @@ bool checkObject(void* obj, const char* objname);
 typedef int32_t fixed_t;
 struct FFont;
 typedef struct FFont FFont;
+struct FGlyph;
+struct FBandRecord;
+struct FEdgeCache;
 
 // Defines the fixed point conversions
 #define FIXED_POINT_SHIFT 4
@@ -60,10 +63,58 @@ typedef struct FRect {
     FSize size;
 } FRect;
 
+/* Affine transform with FMATRIX_SHIFT fractional bits,
+ *   x' = (a*x + c*y + tx) >> FMATRIX_SHIFT
+ *   y' = (b*x + d*y + ty) >> FMATRIX_SHIFT
+ */
+#define FMATRIX_SHIFT 20
+typedef struct FMatrix {
+    int32_t a, b, c, d;
+    int64_t tx, ty;
+} FMatrix;
+
+/* The transform fields that transform_matrix was last built from. */
+typedef struct FTransformKey {
+    FPoint pivot;
+    FPoint offset;
+    FPoint scale_from;
+    FPoint scale_to;
+    fixed_t rotation;
+    fixed_t subpixel_adjust;
+} FTransformKey;
+
+/* Range of columns in which edge flags have been plotted on one row. */
+typedef struct FSpan {
+    int16_t min_x;
+    int16_t max_x;
+} FSpan;
+
+/* Cached data row info for one row of the flag buffer or frame buffer. */
+typedef struct FFlagRow {
+    uint8_t* data;
+    int16_t min_x;
+    int16_t max_x;
+} FFlagRow;
+
 typedef struct FContext {
 	GContext* gctx;
+    bool bound;
 	GBitmap* flag_buffer;
     GRect flag_bounds;
+    FFlagRow* flag_rows;
+    FSpan* flag_spans;
+    int16_t band_rows;
+    int16_t band_top;
+    int16_t band_height;
+    struct FBandRecord* band_records;
+    uint16_t band_record_count;
+    uint16_t band_record_capacity;
+    GBitmap* frame_buffer;
+    FFlagRow* frame_rows;
+    uint8_t* scratch;
+    uint16_t scratch_size;
+    uint16_t scratch_used;
+    bool scratch_sized;
 	FPoint extent_min;
 	FPoint extent_max;
     FPoint path_init_point;
@@ -73,7 +124,11 @@ typedef struct FContext {
     FPoint transform_scale_from;
 	FPoint transform_scale_to;
     fixed_t transform_rotation;
+    FMatrix transform_matrix;
+    FTransformKey transform_key;
 	fixed_t subpixel_adjust;
+    fixed_t curve_tolerance;
+    struct FEdgeCache* edge_capture;
 
     GColor fill_color;
 	int16_t color_bias;
@@ -85,6 +140,7 @@ void fctx_set_pivot(FContext* fctx, FPoint pivot);
 void fctx_set_offset(FContext* fctx, FPoint offset);
 void fctx_set_scale(FContext* fctx, FPoint scale_from, FPoint scale_to);
 void fctx_set_rotation(FContext* fctx, uint32_t rotation);
+void fctx_set_curve_tolerance(FContext* fctx, fixed_t tolerance);
 
 void fctx_transform_points(FContext* fctx, uint16_t pcount, FPoint* ppoints, FPoint* tpoints, FPoint advance);
 
@@ -98,14 +154,32 @@ void fctx_draw_path_with_buffer(FContext* fctx, FPoint* points, FPoint* buffer,
 typedef void (*fctx_init_context_func)(FContext* fctx, GContext* gctx);
 typedef void (*fctx_plot_edge_func)(FContext* fctx, FPoint* a, FPoint* b);
 typedef void (*fctx_plot_circle_func)(FContext* fctx, const FPoint* c, fixed_t r);
+typedef void (*fctx_plot_arc_func)(FContext* fctx, const FPoint* c, fixed_t inner_r, fixed_t outer_r,
+                                   int32_t start_angle, int32_t end_angle);
+typedef void (*fctx_plot_ellipse_func)(FContext* fctx, const FPoint* c, fixed_t rx, fixed_t ry);
+typedef void (*fctx_plot_rounded_rect_func)(FContext* fctx, const FRect* rect, fixed_t r);
 typedef void (*fctx_end_fill_func)(FContext* fctx);
 
 extern fctx_init_context_func fctx_init_context;
 extern void fctx_begin_fill(FContext* fctx);
 extern fctx_plot_edge_func fctx_plot_edge;
 extern fctx_plot_circle_func fctx_plot_circle;
+extern fctx_plot_arc_func fctx_plot_arc;
+extern fctx_plot_ellipse_func fctx_plot_ellipse;
+extern fctx_plot_rounded_rect_func fctx_plot_rounded_rect;
+void fctx_plot_ring(FContext* fctx, const FPoint* c, fixed_t inner_r, fixed_t outer_r);
+void fctx_plot_sector(FContext* fctx, const FPoint* c, fixed_t r, int32_t start_angle, int32_t end_angle);
 extern fctx_end_fill_func fctx_end_fill;
 extern void fctx_deinit_context(FContext* fctx);
+void fctx_bind_context(FContext* fctx, GContext* gctx);
+void fctx_begin_frame(FContext* fctx);
+void fctx_end_frame(FContext* fctx);
+
+void fctx_set_scratch_size(FContext* fctx, uint16_t size);
+
+void fctx_init_context_banded(FContext* fctx, GContext* gctx, int16_t band_rows);
+void fctx_set_band_height(FContext* fctx, int16_t rows);
+int16_t fctx_get_band_height(FContext* fctx);
 
 #ifdef PBL_COLOR
 void fctx_enable_aa(bool enable);
@@ -124,6 +198,81 @@ typedef struct __attribute__((__packed__)) FPathDrawCommand {
 
 void fctx_draw_commands(FContext* fctx, FPoint advance, void* path_data, uint16_t length);
 
+/* Bounding box of the points of a path, in path coordinates.  Bounds with
+ * min_x > max_x are unknown, and never culled.
+ */
+typedef struct __attribute__((__packed__)) FPathBounds {
+    fixed16_t min_x;
+    fixed16_t min_y;
+    fixed16_t max_x;
+    fixed16_t max_y;
+} FPathBounds;
+
+bool fpath_compute_bounds(void* path_data, uint16_t length, FPathBounds* bounds);
+bool fctx_bounds_visible(FContext* fctx, FPoint advance, const FPathBounds* bounds);
+
+/* Compact path encoding: a two byte header, then one byte command codes (as
+ * above), each followed by its coordinates relative to the current point.
+ * A coordinate is an int8, or the escape byte followed by a little endian
+ * int16.  fctx_draw_commands detects the header and defers to
+ * fctx_draw_compact_commands.
+ */
+#define FPATH_COMPACT_MAGIC 0xFC
+#define FPATH_COMPACT_VERSION 1
+#define FPATH_COMPACT_ESCAPE (-128)
+
+static inline bool fpath_is_compact(const void* path_data, uint16_t length) {
+    return length >= 2 && ((const uint8_t*)path_data)[0] == FPATH_COMPACT_MAGIC;
+}
+
+void fctx_draw_compact_commands(FContext* fctx, FPoint advance, void* path_data, uint16_t length);
+
+/* Path commands decoded once into opcodes and absolute points, so that they
+ * can be drawn without parsing.  Closepath is decoded as a lineto.
+ */
+typedef enum FPathOp {
+    FPathOpMoveTo = 0,
+    FPathOpLineTo,
+    FPathOpCurveTo,
+    FPathOpQuadTo
+} FPathOp;
+
+typedef struct FDecodedPath {
+    uint16_t op_count;
+    uint16_t point_count;
+    uint8_t* ops;
+    FPoint* points;
+} FDecodedPath;
+
+FDecodedPath* fpath_decode(void* path_data, uint16_t length);
+void fpath_decoded_destroy(FDecodedPath* path);
+FDecodedPath* fpath_flatten(void* path_data, uint16_t length, FPoint scale_from, FPoint scale_to);
+void fctx_draw_decoded_path(FContext* fctx, FPoint advance, const FDecodedPath* path);
+
+/* The flattened, transformed edges of one path, kept for as long as the path
+ * is redrawn with the same transform.  At most edge_capacity edges are kept;
+ * a path with more edges is drawn without caching.  While a path is drawn
+ * for capture, the context's edge_capture points at the cache.
+ */
+typedef struct FEdgeCache {
+    const void* path_data;
+    uint16_t length;
+    uint16_t edge_count;
+    uint16_t edge_capacity;
+    bool valid;
+    FMatrix matrix;
+    FPoint advance;
+    fixed_t tolerance;
+    FPoint extent_min;
+    FPoint extent_max;
+    FPoint* edges;
+} FEdgeCache;
+
+FEdgeCache* fedge_cache_create(uint16_t max_edges);
+void fedge_cache_invalidate(FEdgeCache* cache);
+void fedge_cache_destroy(FEdgeCache* cache);
+void fctx_draw_commands_cached(FContext* fctx, FEdgeCache* cache, FPoint advance, void* path_data, uint16_t length);
+
 // -----------------------------------------------------------------------------
 // Text drawing.
 // -----------------------------------------------------------------------------
@@ -141,3 +290,23 @@ void fctx_set_text_em_height(FContext* fctx, FFont* font, int16_t pixels);
 void fctx_set_text_cap_height(FContext* fctx, FFont* font, int16_t pixels);
 fixed_t fctx_string_width(FContext* fctx, const char* text, FFont* font);
 void fctx_draw_string(FContext* fctx, const char* text, FFont* font, GTextAlignment alignment, FTextAnchor anchor);
+
+/* A string that has been decoded, looked up, aligned and anchored once, for
+ * drawing many times.  Positions are in font units, not pre-scaled, so a
+ * layout may be drawn at any scale; the transform applies the scale to the
+ * glyph outlines in any case.
+ */
+typedef struct FTextLayout {
+    FFont* font;
+    fixed_t width;
+    uint16_t glyph_count;
+    uint16_t glyph_capacity;
+    struct FGlyph** glyphs;
+    FPoint* origins;
+} FTextLayout;
+
+FTextLayout* ftext_layout_create(const char* text, FFont* font, GTextAlignment alignment, FTextAnchor anchor);
+bool ftext_layout_set_text(FTextLayout* layout, const char* text, FFont* font, GTextAlignment alignment, FTextAnchor anchor);
+void ftext_layout_destroy(FTextLayout* layout);
+fixed_t fctx_layout_width(FContext* fctx, FTextLayout* layout);
+void fctx_draw_layout(FContext* fctx, FTextLayout* layout);
@@ -24,7 +24,22 @@ typedef struct __attribute__((__packed__)) FGlyph {
 
 FFont* ffont_load_from_resource_into_buffer(uint32_t resource_id, void* buffer);
 FFont* ffont_create_from_resource(uint32_t resource_id);
+FFont* ffont_create_paged_from_resource(uint32_t resource_id, uint16_t cache_size);
+FFont* ffont_create_subset_from_resource(uint32_t resource_id, const char* charset);
+void ffont_cache_stats(FFont* font, uint32_t* hits, uint32_t* misses);
 void ffont_destroy(FFont* font);
 void ffont_debug_log(FFont* font, uint8_t log_level);
 FGlyph* ffont_glyph_info(FFont* font, uint16_t unicode);
 void* ffont_glyph_outline(FFont* font, FGlyph* glyph);
+const FPathBounds* ffont_glyph_bounds(FFont* font, FGlyph* glyph);
+
+/* The glyph lookup tables of a font, or NULL for a font loaded into a caller
+ * supplied buffer.  Code that looks up many glyphs of one font can find the
+ * index once and pass it to the _indexed variants, instead of having each
+ * lookup find it again.
+ */
+typedef struct FFontIndex FFontIndex;
+FFontIndex* ffont_find_index(FFont* font);
+FGlyph* ffont_glyph_info_indexed(FFont* font, FFontIndex* index, uint16_t unicode);
+void* ffont_glyph_outline_indexed(FFont* font, FFontIndex* index, FGlyph* glyph);
+const FPathBounds* ffont_glyph_bounds_indexed(FFont* font, FFontIndex* index, FGlyph* glyph);
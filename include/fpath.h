@@ -10,3 +10,4 @@ typedef struct __attribute__((__packed__)) {
 FPath* fpath_load_from_resource_into_buffer(uint32_t resource_id, void* buffer);
 FPath* fpath_create_from_resource(uint32_t resource_id);
 void fpath_destroy(FPath* fpath);
+void fctx_draw_fpath_bounded(FContext* fctx, FPoint advance, FPath* fpath, const FPathBounds* bounds);
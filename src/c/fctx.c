@@ -27,9 +27,8 @@
  * on Sean Eron Anderson's Bit Twiddling Hacks page at
  * http://graphics.stanford.edu/~seander/bithacks.html
  *
- * The bezier function is derived from Łukasz Zalewski's blog post
- * "Bezier Curves and GPaths on Pebble"
- * https://developer.getpebble.com//blog/2015/02/13/Bezier-Curves-And-GPaths/
+ * The bezier segment count is chosen by Wang's formula for the number of
+ * line segments needed to flatten a polynomial curve to a given tolerance.
  *
  */
 
@@ -88,9 +87,544 @@ int32_t edge_step(Edge* e) {
     return e->height;
 }
 
+/*
+ * Arcs.  An arc is the part of a ring between two angles, measured clockwise
+ * from 12 o'clock as for graphics_fill_radial.  Its outline is rasterized
+ * directly: the inner and outer circles by the midpoint algorithm, and the
+ * two radial sides as edges.  Along each half of a circle (right or left of
+ * the center) the row advances monotonically with the angle, so the part of
+ * a half within the arc covers whole ranges of rows.  The ranges end on the
+ * same fixed point rows as the radial edges, which keeps every row of the
+ * outline crossed an even number of times.
+ *
+ * The rasterizers work in units of their own rows, which are a pixel for BW
+ * and a subpixel for AA.  Circle row n covers the unit from n to n + 1, so
+ * on the edge sampling grid the center sits half a unit above and left of
+ * (cx, cy).
+ */
+typedef struct FArcRows {
+    int32_t begin[2];
+    uint32_t count[2];
+} FArcRows;
+
+/* Normalize the angles so that start is in [0, TRIG_MAX_ANGLE) and end is
+ * no more than a full turn beyond.  Returns false if the arc is empty.
+ */
+static bool farc_normalize(int32_t* start, int32_t* end) {
+    int32_t sweep = *end - *start;
+    if (sweep <= 0) {
+        return false;
+    } else if (sweep >= TRIG_MAX_ANGLE) {
+        *start = 0;
+        *end = TRIG_MAX_ANGLE;
+    } else {
+        *start %= TRIG_MAX_ANGLE;
+        if (*start < 0) *start += TRIG_MAX_ANGLE;
+        *end = *start + sweep;
+    }
+    return true;
+}
+
+/* r * ratio / TRIG_MAX_RATIO, rounded to nearest. */
+static inline fixed_t farc_scale(fixed_t r, int32_t ratio) {
+    int64_t v = (int64_t)r * ratio;
+    return (fixed_t)((v >= 0 ? v + TRIG_MAX_RATIO / 2 : v - TRIG_MAX_RATIO / 2) / TRIG_MAX_RATIO);
+}
+
+static inline fixed_t farc_dx(fixed_t r, int32_t angle) {
+    return farc_scale(r, sin_lookup(angle % TRIG_MAX_ANGLE));
+}
+
+static inline fixed_t farc_dy(fixed_t r, int32_t angle) {
+    return -farc_scale(r, cos_lookup(angle % TRIG_MAX_ANGLE));
+}
+
+/* Point on the circle of radius r about center e, at the given angle. */
+static inline FPoint farc_point(const FPoint* e, fixed_t r, int32_t angle) {
+    return FPoint(e->x + farc_dx(r, angle), e->y + farc_dy(r, angle));
+}
+
+/* Ceiling of v / unit, the first row sampled at or below v. */
+static inline int32_t farc_ceil(fixed_t v, int32_t unit) {
+    int32_t q = v / unit;
+    return (v > 0 && v % unit) ? q + 1 : q;
+}
+
+/* Compute the rows (relative to row top) covered by the right (rows[0]) and
+ * left (rows[1]) halves of the circle of radius r about e, within the arc.
+ */
+static void farc_rows(FArcRows rows[2], const FPoint* e, fixed_t r, int32_t start, int32_t end,
+                      int32_t unit, int32_t top) {
+    const int32_t half = TRIG_MAX_ANGLE / 2;
+    for (int32_t k = 0; k < 4; ++k) {
+        FArcRows* side = rows + (k & 1);
+        int32_t a = (start > k * half) ? start : k * half;
+        int32_t b = (end < (k + 1) * half) ? end : (k + 1) * half;
+        side->begin[k / 2] = 0;
+        side->count[k / 2] = 0;
+        if (a < b) {
+            fixed_t ya = farc_dy(r, a);
+            fixed_t yb = farc_dy(r, b);
+            int32_t begin = farc_ceil(e->y + (ya < yb ? ya : yb), unit);
+            int32_t end = farc_ceil(e->y + (ya < yb ? yb : ya), unit);
+            side->begin[k / 2] = begin - top;
+            side->count[k / 2] = end - begin;
+        }
+    }
+}
+
+static inline bool farc_rows_contain(const FArcRows* rows, int32_t y) {
+    return (uint32_t)(y - rows->begin[0]) < rows->count[0] || (uint32_t)(y - rows->begin[1]) < rows->count[1];
+}
+
+/*
+ * Ellipses and rounded rects.  A quarter ellipse is stepped row by row from
+ * its outermost row inward with an incremental midpoint test, which gives
+ * the number of whole units w, counted out from the center, whose centers
+ * lie inside the ellipse on each row.  As for circles, the center sits on a
+ * unit boundary, and each row gets exactly one flag on each side.  With
+ * g(w, n) = (2w + 1)^2 ry^2 + (2n + 1)^2 rx^2 - 4 rx^2 ry^2, the unit w of
+ * row n is inside when g <= 0.
+ */
+typedef struct FEllipseStepper {
+    int64_t g;
+    int64_t rx2;
+    int64_t ry2;
+    int32_t w;
+    int32_t n;
+} FEllipseStepper;
+
+static void fellipse_init(FEllipseStepper* e, int32_t rx, int32_t ry) {
+    e->rx2 = (int64_t)rx * rx;
+    e->ry2 = (int64_t)ry * ry;
+    e->w = 0;
+    e->n = ry - 1;
+    e->g = e->ry2 + (int64_t)(2 * e->n + 1) * (2 * e->n + 1) * e->rx2 - 4 * e->rx2 * e->ry2;
+}
+
+/* Return the width of row n, then move in to row n - 1. */
+static inline int32_t fellipse_step(FEllipseStepper* e) {
+    while (e->g <= 0) {
+        e->g += 8 * e->ry2 * (e->w + 1);
+        ++e->w;
+    }
+    e->g -= 8 * e->rx2 * e->n;
+    --e->n;
+    return e->w;
+}
+
+static inline void fspan_reset(FSpan* span) {
+    span->min_x = INT16_MAX;
+    span->max_x = INT16_MIN;
+}
+
+static inline void fspan_touch(FSpan* span, int16_t x) {
+    if (x < span->min_x) span->min_x = x;
+    if (x > span->max_x) span->max_x = x;
+}
+
+/* Allocate the per-row tables for the flag buffer: the cached row info, so
+ * that the plotters need not call gbitmap_get_data_row_info, and the span
+ * table that records which columns of each row have been touched during the
+ * current fill.
+ */
+static void fctx_init_rows(FContext* fctx) {
+    fctx->flag_rows = malloc(fctx->band_height * sizeof(FFlagRow));
+    fctx->flag_spans = malloc(fctx->band_height * sizeof(FSpan));
+    if (CHECK(fctx->flag_rows) && CHECK(fctx->flag_spans) && fctx->flag_buffer) {
+        for (int16_t row = 0; row < fctx->band_height; ++row) {
+            GBitmapDataRowInfo info = gbitmap_get_data_row_info(fctx->flag_buffer, row);
+            fctx->flag_rows[row].data = info.data;
+            fctx->flag_rows[row].min_x = info.min_x;
+            fctx->flag_rows[row].max_x = info.max_x;
+            fspan_reset(fctx->flag_spans + row);
+        }
+    }
+}
+
+/*
+ * Flag buffers for persistent contexts come from a small pool, so that
+ * contexts with the same flag buffer size and format (one per layer, say)
+ * share a single buffer.  The fills of contexts that share a buffer must not
+ * overlap, which holds when each is drawn from its own update_proc.
+ */
+#define FLAG_POOL_SIZE 4
+
+typedef struct FFlagPoolEntry {
+    GBitmap* buffer;
+    FFlagRow* rows;
+    FSpan* spans;
+    uint8_t refs;
+} FFlagPoolEntry;
+
+static FFlagPoolEntry s_flag_pool[FLAG_POOL_SIZE];
+
+static FFlagPoolEntry* fctx_find_pool_entry(GBitmap* buffer) {
+    for (int k = 0; k < FLAG_POOL_SIZE; ++k) {
+        if (s_flag_pool[k].refs && s_flag_pool[k].buffer == buffer) {
+            return s_flag_pool + k;
+        }
+    }
+    return NULL;
+}
+
+/* Create the flag buffer and its row tables, or share them from the pool
+ * when pooled, as for a persistent context.
+ */
+static void fctx_create_flag_buffer(FContext* fctx, GBitmapFormat format, bool pooled) {
+
+    GSize size = GSize(fctx->flag_bounds.size.w, fctx->band_height);
+    FFlagPoolEntry* entry = NULL;
+    if (pooled) {
+        for (int k = 0; k < FLAG_POOL_SIZE; ++k) {
+            FFlagPoolEntry* e = s_flag_pool + k;
+            if (e->refs == 0) {
+                if (!entry) entry = e;
+            } else if (gbitmap_get_format(e->buffer) == format &&
+                       gbitmap_get_bounds(e->buffer).size.w == size.w &&
+                       gbitmap_get_bounds(e->buffer).size.h == size.h) {
+                e->refs += 1;
+                fctx->flag_buffer = e->buffer;
+                fctx->flag_rows = e->rows;
+                fctx->flag_spans = e->spans;
+                return;
+            }
+        }
+        if (!entry) {
+            APP_LOG(APP_LOG_LEVEL_WARNING, "flag buffer pool is full");
+        }
+    }
+
+    fctx->flag_buffer = gbitmap_create_blank(size, format);
+    CHECK(fctx->flag_buffer);
+    fctx_init_rows(fctx);
+
+    if (entry && fctx->flag_buffer && fctx->flag_rows && fctx->flag_spans) {
+        entry->buffer = fctx->flag_buffer;
+        entry->rows = fctx->flag_rows;
+        entry->spans = fctx->flag_spans;
+        entry->refs = 1;
+    }
+}
+
+static void fctx_destroy_flag_buffer(FContext* fctx) {
+    FFlagPoolEntry* entry = fctx_find_pool_entry(fctx->flag_buffer);
+    if (entry) {
+        entry->refs -= 1;
+        if (entry->refs == 0) {
+            gbitmap_destroy(entry->buffer);
+            free(entry->rows);
+            free(entry->spans);
+            entry->buffer = NULL;
+        }
+    } else {
+        gbitmap_destroy(fctx->flag_buffer);
+        free(fctx->flag_rows);
+        free(fctx->flag_spans);
+    }
+    fctx->flag_buffer = NULL;
+    fctx->flag_rows = NULL;
+    fctx->flag_spans = NULL;
+}
+
+/*
+ * Banded rendering.  When a band height smaller than the frame is selected,
+ * the flag buffer covers only that many rows.  The plot functions then record
+ * each primitive instead of rasterizing it, and end_fill replays the record
+ * once per band, resolving each band to the frame before moving on to the
+ * next.  Rasterization is always done in frame coordinates and translated by
+ * band_top at the integer row stage, so that the bands join without seams.
+ */
+typedef enum FBandRecordType {
+    FBandRecordEdge,
+    FBandRecordCircle,
+    FBandRecordArc,
+    FBandRecordEllipse,
+    FBandRecordRoundedRect,
+    FBandRecordParams
+} FBandRecordType;
+
+/* Arcs and rounded rects take a second, FBandRecordParams record for the
+ * values that do not fit in the first.
+ */
+typedef struct FBandRecord {
+    uint8_t type;
+    FPoint a; // the center, or for rounded rects the origin
+    FPoint b; // for circles, b.x holds the radius; for arcs, b.x and b.y
+              // hold the outer and inner radii; for ellipses, the radii;
+              // for rounded rects, the size
+} FBandRecord;
+
+typedef void (*fctx_resolve_rows_func)(FContext* fctx, GBitmap* fb, int16_t rowMin, int16_t rowMax);
+
+/* The rasterizers for one mode, as replayed for each band. */
+typedef struct FRasterizer {
+    fctx_plot_edge_func edge;
+    fctx_plot_circle_func circle;
+    fctx_plot_arc_func arc;
+    fctx_plot_ellipse_func ellipse;
+    fctx_plot_rounded_rect_func rounded_rect;
+    fctx_resolve_rows_func resolve_rows;
+} FRasterizer;
+
+void fctx_set_band_height(FContext* fctx, int16_t rows) {
+    fctx->band_rows = rows;
+}
+
+int16_t fctx_get_band_height(FContext* fctx) {
+    return fctx->band_rows;
+}
+
+/* Flag buffer rows for a requested band height; zero means the whole frame. */
+static inline int16_t fctx_band_height_for(FContext* fctx, int16_t rows) {
+    int16_t h = fctx->flag_bounds.size.h;
+    return (rows > 0 && rows < h) ? rows : h;
+}
+
+static void fctx_init_band(FContext* fctx, int16_t rows) {
+    fctx->band_rows = rows;
+    fctx->band_top = 0;
+    fctx->band_height = fctx_band_height_for(fctx, rows);
+    fctx->band_records = NULL;
+    fctx->band_record_count = 0;
+    fctx->band_record_capacity = 0;
+}
+
+/* Whether any part of a box may fall within the flag bounds. */
+static inline bool fctx_box_visible(FContext* fctx, fixed_t min_x, fixed_t min_y, fixed_t max_x, fixed_t max_y) {
+    GRect b = fctx->flag_bounds;
+    return max_x >= INT_TO_FIXED(b.origin.x - 1) && min_x <= INT_TO_FIXED(b.origin.x + b.size.w + 1)
+        && max_y >= INT_TO_FIXED(b.origin.y - 1) && min_y <= INT_TO_FIXED(b.origin.y + b.size.h + 1);
+}
+
+/* Whether any part of a circle may fall within the flag bounds. */
+static inline bool fctx_circle_visible(FContext* fctx, const FPoint* c, fixed_t r) {
+    return fctx_box_visible(fctx, c->x - r, c->y - r, c->x + r, c->y + r);
+}
+
+/* Expand the bounding box of pixels drawn. */
+static inline void fctx_expand_extent(FContext* fctx, fixed_t min_x, fixed_t min_y, fixed_t max_x, fixed_t max_y) {
+    if (min_x < fctx->extent_min.x) fctx->extent_min.x = min_x;
+    if (min_y < fctx->extent_min.y) fctx->extent_min.y = min_y;
+    if (max_x > fctx->extent_max.x) fctx->extent_max.x = max_x;
+    if (max_y > fctx->extent_max.y) fctx->extent_max.y = max_y;
+}
+
+static inline bool fctx_is_banded(FContext* fctx) {
+    return fctx->band_height < fctx->flag_bounds.size.h;
+}
+
+/* Number of flag buffer rows that fall within the frame for the current band. */
+static inline int16_t fctx_band_rows(FContext* fctx) {
+    int16_t rows = fctx->flag_bounds.size.h - fctx->band_top;
+    return (rows < fctx->band_height) ? rows : fctx->band_height;
+}
+
+static void fctx_record_band(FContext* fctx, uint8_t type, FPoint a, FPoint b) {
+    if (fctx->band_record_count == fctx->band_record_capacity) {
+        uint16_t capacity = fctx->band_record_capacity ? (uint16_t)(fctx->band_record_capacity * 2) : 64;
+        if (capacity <= fctx->band_record_capacity) {
+            APP_LOG(APP_LOG_LEVEL_ERROR, "band record overflow");
+            return;
+        }
+        FBandRecord* records = realloc(fctx->band_records, capacity * sizeof(FBandRecord));
+        if (!records) {
+            APP_LOG(APP_LOG_LEVEL_ERROR, "failed to grow band record to %d entries", capacity);
+            return;
+        }
+        fctx->band_records = records;
+        fctx->band_record_capacity = capacity;
+    }
+    FBandRecord* record = fctx->band_records + fctx->band_record_count++;
+    record->type = type;
+    record->a = a;
+    record->b = b;
+}
+
+/* Record a primitive that needs a second record for its parameters. */
+static void fctx_record_band_params(FContext* fctx, uint8_t type, FPoint a, FPoint b, FPoint params) {
+    uint16_t count = fctx->band_record_count;
+    fctx_record_band(fctx, type, a, b);
+    fctx_record_band(fctx, FBandRecordParams, params, FPointZero);
+    if (fctx->band_record_count != count + 2) {
+        fctx->band_record_count = count;
+    }
+}
+
+/* Rasterize the recorded primitives that may touch the current band. */
+static void fctx_replay_band(FContext* fctx, const FRasterizer* raster) {
+    fixed_t top = INT_TO_FIXED(fctx->band_top - 1);
+    fixed_t bottom = INT_TO_FIXED(fctx->band_top + fctx->band_height + 1);
+    FBandRecord* record = fctx->band_records;
+    FBandRecord* end = record + fctx->band_record_count;
+    for (; record < end; ++record) {
+        if (record->type == FBandRecordEdge) {
+            if ((record->a.y < top && record->b.y < top) ||
+                (record->a.y > bottom && record->b.y > bottom)) {
+                continue;
+            }
+            raster->edge(fctx, &record->a, &record->b);
+        } else if (record->type == FBandRecordCircle) {
+            if (record->a.y + record->b.x < top || record->a.y - record->b.x > bottom) {
+                continue;
+            }
+            raster->circle(fctx, &record->a, record->b.x);
+        } else if (record->type == FBandRecordArc) {
+            FBandRecord* arc = record++;
+            if (arc->a.y + arc->b.x < top || arc->a.y - arc->b.x > bottom) {
+                continue;
+            }
+            raster->arc(fctx, &arc->a, arc->b.y, arc->b.x, record->a.x, record->a.y);
+        } else if (record->type == FBandRecordEllipse) {
+            if (record->a.y + record->b.y < top || record->a.y - record->b.y > bottom) {
+                continue;
+            }
+            raster->ellipse(fctx, &record->a, record->b.x, record->b.y);
+        } else if (record->type == FBandRecordRoundedRect) {
+            FBandRecord* rect = record++;
+            if (rect->a.y + rect->b.y < top || rect->a.y > bottom) {
+                continue;
+            }
+            FRect r = { rect->a, { rect->b.x, rect->b.y } };
+            raster->rounded_rect(fctx, &r, record->a.x);
+        }
+    }
+}
+
+/* Resolve the accumulated fill to the frame, one band at a time if banded. */
+static void fctx_resolve_bands(FContext* fctx, const FRasterizer* raster) {
+
+    int16_t rowMin = FIXED_TO_INT(fctx->extent_min.y);
+    int16_t rowMax = FIXED_TO_INT(fctx->extent_max.y);
+
+    if (rowMin < 0) rowMin = 0;
+    if (rowMax >= fctx->flag_bounds.size.h) rowMax = fctx->flag_bounds.size.h - 1;
+
+    /* Within a frame session the frame buffer is already captured. */
+    GBitmap* fb = fctx->frame_buffer ? fctx->frame_buffer : graphics_capture_frame_buffer(fctx->gctx);
+
+    if (fctx_is_banded(fctx)) {
+        int16_t top;
+        for (top = rowMin; top <= rowMax; top += fctx->band_height) {
+            fctx->band_top = top;
+            fctx_replay_band(fctx, raster);
+            /* Resolve the whole band so that no flags are left behind. */
+            raster->resolve_rows(fctx, fb, top, top + fctx_band_rows(fctx) - 1);
+        }
+        fctx->band_top = 0;
+        fctx->band_record_count = 0;
+    } else {
+        raster->resolve_rows(fctx, fb, rowMin, rowMax);
+    }
+
+    if (!fctx->frame_buffer) {
+        graphics_release_frame_buffer(fctx->gctx, fb);
+    }
+}
+
+/*
+ * Frame sessions.  Between fctx_begin_frame and fctx_end_frame the frame
+ * buffer stays captured and its row info is cached in frame_rows, so that
+ * each fill resolves straight into it.
+ */
+void fctx_begin_frame(FContext* fctx) {
+
+    if (fctx->frame_buffer) {
+        APP_LOG(APP_LOG_LEVEL_WARNING, "frame session already open");
+        return;
+    }
+    int16_t h = fctx->flag_bounds.size.h;
+    if (!fctx->frame_rows) {
+        fctx->frame_rows = malloc(h * sizeof(FFlagRow));
+        if (!CHECK(fctx->frame_rows)) {
+            return;
+        }
+    }
+    GBitmap* fb = graphics_capture_frame_buffer(fctx->gctx);
+    if (!CHECK(fb)) {
+        return;
+    }
+    for (int16_t row = 0; row < h; ++row) {
+        GBitmapDataRowInfo info = gbitmap_get_data_row_info(fb, row);
+        fctx->frame_rows[row].data = info.data;
+        fctx->frame_rows[row].min_x = info.min_x;
+        fctx->frame_rows[row].max_x = info.max_x;
+    }
+    fctx->frame_buffer = fb;
+}
+
+void fctx_end_frame(FContext* fctx) {
+    if (fctx->frame_buffer) {
+        graphics_release_frame_buffer(fctx->gctx, fctx->frame_buffer);
+        fctx->frame_buffer = NULL;
+    }
+}
+
+static inline GBitmapDataRowInfo fctx_frame_row_info(FContext* fctx, GBitmap* fb, int16_t row) {
+    if (fctx->frame_buffer) {
+        const FFlagRow* cached = fctx->frame_rows + row;
+        return (GBitmapDataRowInfo){ .data = cached->data, .min_x = cached->min_x, .max_x = cached->max_x };
+    }
+    return gbitmap_get_data_row_info(fb, row);
+}
+
+/*
+ * Scratch arena.  Temporary buffers needed while a fill is built are bump
+ * allocated from a per-context arena, which is emptied by fctx_begin_fill.
+ * The arena is allocated on first use, so contexts that never need it cost
+ * nothing.  Allocations that do not fit fall back to the heap.
+ */
+#define SCRATCH_DEFAULT_SIZE 256
+#define SCRATCH_ALIGN 4
+
+static void fctx_init_scratch(FContext* fctx) {
+    fctx->scratch = NULL;
+    fctx->scratch_size = SCRATCH_DEFAULT_SIZE;
+    fctx->scratch_sized = false;
+    fctx->scratch_used = 0;
+}
+
+void fctx_set_scratch_size(FContext* fctx, uint16_t size) {
+    free(fctx->scratch);
+    fctx->scratch = NULL;
+    fctx->scratch_size = size;
+    fctx->scratch_sized = true;
+    fctx->scratch_used = 0;
+}
+
+static void* fctx_scratch_alloc(FContext* fctx, size_t size) {
+    size_t used = (fctx->scratch_used + SCRATCH_ALIGN - 1) & ~(size_t)(SCRATCH_ALIGN - 1);
+    if (used + size <= fctx->scratch_size) {
+        if (!fctx->scratch) {
+            fctx->scratch = malloc(fctx->scratch_size);
+            if (!fctx->scratch) {
+                APP_LOG(APP_LOG_LEVEL_WARNING, "failed to allocate %d byte scratch arena", fctx->scratch_size);
+                return malloc(size);
+            }
+        }
+        fctx->scratch_used = (uint16_t)(used + size);
+        return fctx->scratch + used;
+    }
+    return malloc(size);
+}
+
+/* Release a scratch allocation.  Arena allocations are only reclaimed when
+ * they are the most recent, or when the arena is reset.
+ */
+static void fctx_scratch_free(FContext* fctx, void* ptr, size_t size) {
+    uint8_t* p = ptr;
+    if (fctx->scratch && p >= fctx->scratch && p < fctx->scratch + fctx->scratch_size) {
+        if (p + size == fctx->scratch + fctx->scratch_used) {
+            fctx->scratch_used = (uint16_t)(p - fctx->scratch);
+        }
+    } else {
+        free(ptr);
+    }
+}
+
 void fctx_begin_fill(FContext* fctx) {
 
-    GRect bounds = gbitmap_get_bounds(fctx->flag_buffer);
+    GRect bounds = fctx->flag_bounds;
     fctx->extent_max.x = INT_TO_FIXED(bounds.origin.x);
     fctx->extent_max.y = INT_TO_FIXED(bounds.origin.y);
     fctx->extent_min.x = INT_TO_FIXED(bounds.origin.x + bounds.size.w);
@@ -100,12 +634,23 @@ void fctx_begin_fill(FContext* fctx) {
     fctx->path_init_point.y = 0;
     fctx->path_cur_point.x = 0;
     fctx->path_cur_point.y = 0;
+
+    fctx->band_record_count = 0;
+    fctx->scratch_used = 0;
 }
 
 void fctx_deinit_context(FContext* fctx) {
     if (fctx->gctx) {
-        gbitmap_destroy(fctx->flag_buffer);
+        fctx_end_frame(fctx);
+        free(fctx->frame_rows);
+        fctx->frame_rows = NULL;
+        free(fctx->scratch);
+        fctx->scratch = NULL;
+        fctx_destroy_flag_buffer(fctx);
+        free(fctx->band_records);
+        fctx->band_records = NULL;
         fctx->gctx = NULL;
+        fctx->bound = false;
     }
 }
 
@@ -134,6 +679,10 @@ void fctx_set_rotation(FContext* fctx, uint32_t rotation) {
     fctx->transform_rotation = rotation;
 }
 
+void fctx_set_curve_tolerance(FContext* fctx, fixed_t tolerance) {
+    fctx->curve_tolerance = (tolerance > 0) ? tolerance : 1;
+}
+
 // --------------------------------------------------------------------------
 // BW - black and white drawing with 1 bit-per-pixel flag buffer.
 // --------------------------------------------------------------------------
@@ -151,12 +700,19 @@ int32_t fceil(fixed_t value) {
     return returnValue;
 }
 
-void edge_init(Edge* e, FPoint* top, FPoint* bottom) {
+/*
+ * The edge is clipped to the rows yMin..yMax, and the DDA is started directly
+ * at the first visible row rather than stepped there.  Edges that lie wholly
+ * above or below the clip rows are left with a height of zero or less.
+ */
+void edge_init(Edge* e, FPoint* top, FPoint* bottom, int32_t yMin, int32_t yMax) {
 
     e->y = fceil(top->y);
     int32_t yEnd = fceil(bottom->y);
+    if (e->y < yMin) e->y = yMin;
+    if (yEnd > yMax + 1) yEnd = yMax + 1;
     e->height = yEnd - e->y;
-    if (e->height)    {
+    if (e->height > 0)    {
         int32_t dN = bottom->y - top->y;
         int32_t dM = bottom->x - top->x;
         int32_t initialNumerator = dM * 16 * e->y - dM * top->y +
@@ -167,88 +723,112 @@ void edge_init(Edge* e, FPoint* top, FPoint* bottom) {
     }
 }
 
-void fctx_init_context_bw(FContext* fctx, GContext* gctx) {
+static void fctx_update_transform(FContext* fctx);
+
+/* Reset the drawing state to its defaults for BW rendering. */
+static void fctx_init_state_bw(FContext* fctx) {
+    fctx->subpixel_adjust = -FIXED_POINT_SCALE / 2;
+    fctx->transform_pivot = FPointZero;
+    fctx->transform_offset = FPointZero;
+    fctx->transform_scale_from = FPointOne;
+    fctx->transform_scale_to = FPointOne;
+    fctx->transform_rotation = 0;
+    fctx_update_transform(fctx);
+    fctx->curve_tolerance = FIXED_POINT_SCALE / 4;
+    fctx->edge_capture = NULL;
+}
+
+static void fctx_init_bw(FContext* fctx, GContext* gctx, int16_t band_rows, bool pooled) {
 
     GBitmap* frameBuffer = graphics_capture_frame_buffer(gctx);
     if (frameBuffer) {
         fctx->flag_bounds = gbitmap_get_bounds(frameBuffer);
         graphics_release_frame_buffer(gctx, frameBuffer);
 
-        fctx->flag_buffer = gbitmap_create_blank(fctx->flag_bounds.size, GBitmapFormat1Bit);
-        CHECK(fctx->flag_buffer);
+        fctx_init_band(fctx, band_rows);
+        fctx_create_flag_buffer(fctx, GBitmapFormat1Bit, pooled);
+        fctx->frame_buffer = NULL;
+        fctx->frame_rows = NULL;
+        fctx_init_scratch(fctx);
 
         fctx->gctx = gctx;
-        fctx->subpixel_adjust = -FIXED_POINT_SCALE / 2;
-        fctx->transform_pivot = FPointZero;
-        fctx->transform_offset = FPointZero;
-        fctx->transform_scale_from = FPointOne;
-        fctx->transform_scale_to = FPointOne;
-        fctx->transform_rotation = 0;
+        fctx->bound = pooled;
+        fctx_init_state_bw(fctx);
     }
 }
 
-void fctx_plot_edge_bw(FContext* fctx, FPoint* a, FPoint* b) {
+void fctx_init_context_bw(FContext* fctx, GContext* gctx) {
+    fctx_init_bw(fctx, gctx, 0, false);
+}
 
-    Edge edge;
-    if (a->y > b->y) {
-        edge_init(&edge, b, a);
-    } else {
-        edge_init(&edge, a, b);
+static void fctx_rasterize_edge_bw(FContext* fctx, FPoint* a, FPoint* b) {
+
+    /* Edges right of the buffer never plot a flag. */
+    fixed_t right = INT_TO_FIXED(fctx->flag_bounds.size.w + 1);
+    if (a->x >= right && b->x >= right) {
+        return;
     }
 
-    uint8_t* data = gbitmap_get_data(fctx->flag_buffer);
-    int16_t stride = gbitmap_get_bytes_per_row(fctx->flag_buffer);
     int16_t max_x = fctx->flag_bounds.size.w - 1;
-    int16_t max_y = fctx->flag_bounds.size.h - 1;
+    int16_t max_y = fctx_band_rows(fctx) - 1;
 
-    while (edge.height > 0 && edge.y < 0) {
-        edge_step(&edge);
+    Edge edge;
+    if (a->y > b->y) {
+        edge_init(&edge, b, a, fctx->band_top, fctx->band_top + max_y);
+    } else {
+        edge_init(&edge, a, b, fctx->band_top, fctx->band_top + max_y);
     }
+    edge.y -= fctx->band_top;
 
-    while (edge.height > 0 && edge.y <= max_y) {
+    while (edge.height > 0) {
+        uint8_t* data = fctx->flag_rows[edge.y].data;
         if (edge.x < 0) {
-            uint8_t* p = data + edge.y * stride;
+            uint8_t* p = data;
             uint8_t mask = 1;
             *p ^= mask;
+            fspan_touch(fctx->flag_spans + edge.y, 0);
         } else if (edge.x <= max_x) {
-            uint8_t* p = data + edge.y * stride + edge.x / 8;
+            uint8_t* p = data + edge.x / 8;
             uint8_t mask = 1 << (edge.x % 8);
             *p ^= mask;
+            fspan_touch(fctx->flag_spans + edge.y, edge.x);
         }
         edge_step(&edge);
     }
 
 }
 
+void fctx_plot_edge_bw(FContext* fctx, FPoint* a, FPoint* b) {
+    if (fctx_is_banded(fctx)) {
+        fctx_record_band(fctx, FBandRecordEdge, *a, *b);
+    } else {
+        fctx_rasterize_edge_bw(fctx, a, b);
+    }
+}
+
 static inline void fctx_plot_point_bw(FContext* fctx, int16_t x, int16_t y) {
-    int16_t max_y = fctx->flag_bounds.size.h - 1;
-    if (y >= 0 && y < max_y) {
-        uint8_t* data = gbitmap_get_data(fctx->flag_buffer);
-        int16_t stride = gbitmap_get_bytes_per_row(fctx->flag_buffer);
+    if (y >= 0 && y < fctx_band_rows(fctx)) {
+        uint8_t* data = fctx->flag_rows[y].data;
         int16_t max_x = fctx->flag_bounds.size.w - 1;
         if (x < 0) {
-            uint8_t* p = data + y * stride;
+            uint8_t* p = data;
             uint8_t mask = 1;
             *p ^= mask;
+            fspan_touch(fctx->flag_spans + y, 0);
         } else if (x <= max_x) {
-            uint8_t* p = data + y * stride + x / 8;
+            uint8_t* p = data + x / 8;
             uint8_t mask = 1 << (x % 8);
             *p ^= mask;
+            fspan_touch(fctx->flag_spans + y, x);
         }
     }
 }
 
-void fctx_plot_circle_bw(FContext* fctx, const FPoint* fc, fixed_t fr) {
-
-    /* Expand the bounding box of pixels drawn. */
-    if ((fc->x-fr) < fctx->extent_min.x) fctx->extent_min.x = fc->x - fr;
-    if ((fc->y-fr) < fctx->extent_min.y) fctx->extent_min.y = fc->y - fr;
-    if ((fc->x+fr) > fctx->extent_max.x) fctx->extent_max.x = fc->x + fr;
-    if ((fc->y+fr) > fctx->extent_max.y) fctx->extent_max.y = fc->y + fr;
+static void fctx_rasterize_circle_bw(FContext* fctx, const FPoint* fc, fixed_t fr) {
 
     int16_t r = FIXED_TO_INT(fr);
     int16_t cx = FIXED_TO_INT(fc->x);
-    int16_t cy = FIXED_TO_INT(fc->y);
+    int16_t cy = FIXED_TO_INT(fc->y) - fctx->band_top;
 
     fixed_t x = r - 1;
     fixed_t y = 0;
@@ -285,87 +865,306 @@ void fctx_plot_circle_bw(FContext* fctx, const FPoint* fc, fixed_t fr) {
     }
 }
 
-void fctx_end_fill_bw(FContext* fctx) {
+void fctx_plot_circle_bw(FContext* fctx, const FPoint* fc, fixed_t fr) {
 
-    uint8_t color;
-#ifdef PBL_COLOR
-    color = fctx->fill_color.argb;
-#else
-    uint8_t gray = 0;
-    if (gcolor_equal(fctx->fill_color, GColorWhite)) {
-        color = 0xff;
-    } else if (gcolor_equal(fctx->fill_color, GColorBlack)) {
-        color = 0x00;
-    } else {
-        gray = 0b01010101;
-        color = gray;
+    if (!fctx_circle_visible(fctx, fc, fr)) {
+        return;
     }
-#endif
 
-    int16_t rowMin = FIXED_TO_INT(fctx->extent_min.y);
-    int16_t rowMax = FIXED_TO_INT(fctx->extent_max.y);
-    int16_t colMin = FIXED_TO_INT(fctx->extent_min.x);
-    int16_t colMax = FIXED_TO_INT(fctx->extent_max.x);
+    /* Expand the bounding box of pixels drawn. */
+    if ((fc->x-fr) < fctx->extent_min.x) fctx->extent_min.x = fc->x - fr;
+    if ((fc->y-fr) < fctx->extent_min.y) fctx->extent_min.y = fc->y - fr;
+    if ((fc->x+fr) > fctx->extent_max.x) fctx->extent_max.x = fc->x + fr;
+    if ((fc->y+fr) > fctx->extent_max.y) fctx->extent_max.y = fc->y + fr;
 
-    if (rowMin < 0) rowMin = 0;
-    if (rowMax >= fctx->flag_bounds.size.h) rowMax = fctx->flag_bounds.size.h - 1;
+    if (fctx_is_banded(fctx)) {
+        fctx_record_band(fctx, FBandRecordCircle, *fc, FPoint(fr, 0));
+    } else {
+        fctx_rasterize_circle_bw(fctx, fc, fr);
+    }
+}
 
-    GBitmap* fb = graphics_capture_frame_buffer(fctx->gctx);
+/* Plot the parts of a circle that lie within the given rows, right and left. */
+static void fctx_rasterize_arc_circle_bw(FContext* fctx, int16_t cx, int16_t cy, int16_t r, const FArcRows rows[2]) {
 
-    uint8_t* dest;
-    uint8_t* src;
-    uint8_t mask;
-    int16_t col, row;
+    fixed_t x = r - 1;
+    fixed_t y = 0;
+    fixed_t E = 1 - 2*r;
+    while (x >= y) {
 
-    for (row = rowMin; row <= rowMax; ++row) {
-#ifdef PBL_BW
-        if (gray) {
-            if (row & 1) {
-                color = gray;
-            } else {
-                color = ~gray;
+        if (farc_rows_contain(&rows[0], cy+y))   fctx_plot_point_bw(fctx, cx+x+1, cy+y);
+        if (farc_rows_contain(&rows[0], cy-y-1)) fctx_plot_point_bw(fctx, cx+x+1, cy-y-1);
+        if (farc_rows_contain(&rows[1], cy+y))   fctx_plot_point_bw(fctx, cx-x-1, cy+y);
+        if (farc_rows_contain(&rows[1], cy-y-1)) fctx_plot_point_bw(fctx, cx-x-1, cy-y-1);
+
+        E += 4*y + 4;
+        if (E > 0) {
+            /* As for circles, plot the reflected octants only on a step. */
+            if (x != y) {
+                if (farc_rows_contain(&rows[0], cy+x))   fctx_plot_point_bw(fctx, cx+y+1, cy+x);
+                if (farc_rows_contain(&rows[0], cy-x-1)) fctx_plot_point_bw(fctx, cx+y+1, cy-x-1);
+                if (farc_rows_contain(&rows[1], cy+x))   fctx_plot_point_bw(fctx, cx-y-1, cy+x);
+                if (farc_rows_contain(&rows[1], cy-x-1)) fctx_plot_point_bw(fctx, cx-y-1, cy-x-1);
             }
+            E += -4*x;
+            --x;
         }
-#endif
-        GBitmapDataRowInfo fbRowInfo = gbitmap_get_data_row_info(fb, row);
-        GBitmapDataRowInfo flagRowInfo = gbitmap_get_data_row_info(fctx->flag_buffer, row);
-        int16_t spanMin = (fbRowInfo.min_x > colMin) ? fbRowInfo.min_x : colMin;
-        int16_t spanMax = (fbRowInfo.max_x < colMax) ? fbRowInfo.max_x : colMax;
+        ++y;
+    }
+}
 
-        bool inside = false;
-        for (col = spanMin; col <= spanMax; ++col) {
+static void fctx_rasterize_arc_bw(FContext* fctx, const FPoint* c, fixed_t inner_r, fixed_t outer_r,
+                                  int32_t start, int32_t end) {
 
-#ifdef PBL_COLOR
-            dest = fbRowInfo.data + col;
-#else
-            dest = fbRowInfo.data + col / 8;
-#endif
-            src = flagRowInfo.data + col / 8;
-            mask = 1 << (col % 8);
-            if (*src & mask) {
-                inside = !inside;
-            }
-            *src &= ~mask;
-            if (inside) {
-#ifdef PBL_COLOR
-                *dest = color;
-#else
-                *dest = (color & mask) | (*dest & ~mask);
-#endif
-            }
-        }
-        if (col < flagRowInfo.max_x) {
-            src = flagRowInfo.data + col / 8;
-            mask = 1 << (col % 8);
-            *src &= ~mask;
-        }
+    /* A full ring is just its two circles. */
+    if (end - start >= TRIG_MAX_ANGLE) {
+        fctx_rasterize_circle_bw(fctx, c, outer_r);
+        fctx_rasterize_circle_bw(fctx, c, inner_r);
+        return;
     }
 
-    graphics_release_frame_buffer(fctx->gctx, fb);
+    int16_t ri = FIXED_TO_INT(inner_r);
+    int16_t ro = FIXED_TO_INT(outer_r);
+    int16_t cx = FIXED_TO_INT(c->x);
+    int16_t cy = FIXED_TO_INT(c->y);
+    FPoint e = FPoint(INT_TO_FIXED(cx) - FIXED_POINT_SCALE / 2, INT_TO_FIXED(cy) - FIXED_POINT_SCALE / 2);
+
+    FArcRows rows[2];
+    farc_rows(rows, &e, INT_TO_FIXED(ro), start, end, FIXED_POINT_SCALE, fctx->band_top);
+    fctx_rasterize_arc_circle_bw(fctx, cx, cy - fctx->band_top, ro, rows);
+    if (ri > 0) {
+        farc_rows(rows, &e, INT_TO_FIXED(ri), start, end, FIXED_POINT_SCALE, fctx->band_top);
+        fctx_rasterize_arc_circle_bw(fctx, cx, cy - fctx->band_top, ri, rows);
+    }
 
+    FPoint a = farc_point(&e, INT_TO_FIXED(ri), start);
+    FPoint b = farc_point(&e, INT_TO_FIXED(ro), start);
+    fctx_rasterize_edge_bw(fctx, &a, &b);
+    a = farc_point(&e, INT_TO_FIXED(ri), end);
+    b = farc_point(&e, INT_TO_FIXED(ro), end);
+    fctx_rasterize_edge_bw(fctx, &a, &b);
 }
 
-// --------------------------------------------------------------------------
+void fctx_plot_arc_bw(FContext* fctx, const FPoint* c, fixed_t inner_r, fixed_t outer_r,
+                      int32_t start_angle, int32_t end_angle) {
+
+    if (inner_r < 0) inner_r = 0;
+    if (outer_r <= inner_r || !farc_normalize(&start_angle, &end_angle)) {
+        return;
+    }
+    if (!fctx_circle_visible(fctx, c, outer_r)) {
+        return;
+    }
+
+    fctx_expand_extent(fctx, c->x - outer_r, c->y - outer_r, c->x + outer_r, c->y + outer_r);
+
+    if (fctx_is_banded(fctx)) {
+        fctx_record_band_params(fctx, FBandRecordArc, *c, FPoint(outer_r, inner_r), FPoint(start_angle, end_angle));
+    } else {
+        fctx_rasterize_arc_bw(fctx, c, inner_r, outer_r, start_angle, end_angle);
+    }
+}
+
+static void fctx_rasterize_ellipse_bw(FContext* fctx, const FPoint* c, fixed_t frx, fixed_t fry) {
+
+    int16_t rx = FIXED_TO_INT(frx);
+    int16_t ry = FIXED_TO_INT(fry);
+    int16_t cx = FIXED_TO_INT(c->x);
+    int16_t cy = FIXED_TO_INT(c->y) - fctx->band_top;
+    if (rx <= 0 || ry <= 0) {
+        return;
+    }
+
+    FEllipseStepper e;
+    fellipse_init(&e, rx, ry);
+    for (int16_t n = ry - 1; n >= 0; --n) {
+        int16_t w = fellipse_step(&e);
+        fctx_plot_point_bw(fctx, cx-w, cy+n);
+        fctx_plot_point_bw(fctx, cx+w, cy+n);
+        fctx_plot_point_bw(fctx, cx-w, cy-n-1);
+        fctx_plot_point_bw(fctx, cx+w, cy-n-1);
+    }
+}
+
+void fctx_plot_ellipse_bw(FContext* fctx, const FPoint* c, fixed_t rx, fixed_t ry) {
+
+    if (!fctx_box_visible(fctx, c->x - rx, c->y - ry, c->x + rx, c->y + ry)) {
+        return;
+    }
+    fctx_expand_extent(fctx, c->x - rx, c->y - ry, c->x + rx, c->y + ry);
+
+    if (fctx_is_banded(fctx)) {
+        fctx_record_band(fctx, FBandRecordEllipse, *c, FPoint(rx, ry));
+    } else {
+        fctx_rasterize_ellipse_bw(fctx, c, rx, ry);
+    }
+}
+
+static void fctx_rasterize_rounded_rect_bw(FContext* fctx, const FRect* rect, fixed_t fr) {
+
+    int16_t x0 = FIXED_TO_INT(rect->origin.x);
+    int16_t y0 = FIXED_TO_INT(rect->origin.y) - fctx->band_top;
+    int16_t x1 = FIXED_TO_INT(rect->origin.x + rect->size.w);
+    int16_t y1 = FIXED_TO_INT(rect->origin.y + rect->size.h) - fctx->band_top;
+    int16_t r = FIXED_TO_INT(fr);
+    if (r > (x1 - x0) / 2) r = (x1 - x0) / 2;
+    if (r > (y1 - y0) / 2) r = (y1 - y0) / 2;
+
+    if (r > 0) {
+        FEllipseStepper e;
+        fellipse_init(&e, r, r);
+        for (int16_t n = r - 1; n >= 0; --n) {
+            int16_t inset = r - fellipse_step(&e);
+            fctx_plot_point_bw(fctx, x0+inset, y0+r-n-1);
+            fctx_plot_point_bw(fctx, x1-inset, y0+r-n-1);
+            fctx_plot_point_bw(fctx, x0+inset, y1-r+n);
+            fctx_plot_point_bw(fctx, x1-inset, y1-r+n);
+        }
+    }
+    for (int16_t y = y0 + r; y < y1 - r; ++y) {
+        fctx_plot_point_bw(fctx, x0, y);
+        fctx_plot_point_bw(fctx, x1, y);
+    }
+}
+
+void fctx_plot_rounded_rect_bw(FContext* fctx, const FRect* rect, fixed_t r) {
+
+    fixed_t x1 = rect->origin.x + rect->size.w;
+    fixed_t y1 = rect->origin.y + rect->size.h;
+    if (rect->size.w <= 0 || rect->size.h <= 0 || !fctx_box_visible(fctx, rect->origin.x, rect->origin.y, x1, y1)) {
+        return;
+    }
+    fctx_expand_extent(fctx, rect->origin.x, rect->origin.y, x1, y1);
+
+    if (fctx_is_banded(fctx)) {
+        fctx_record_band_params(fctx, FBandRecordRoundedRect, rect->origin, FPoint(rect->size.w, rect->size.h),
+                                FPoint(r, 0));
+    } else {
+        fctx_rasterize_rounded_rect_bw(fctx, rect, r);
+    }
+}
+
+/* Inclusive prefix-XOR of the bits of a word, least significant bit first.
+ * Bit n of the result is the parity of flag bits 0..n, which is to say,
+ * whether pixel n is inside the shape.
+ */
+static inline uint32_t prefix_xor32(uint32_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    return x;
+}
+
+/* Mask of the bits of the 32 pixel word starting at x0 that lie within
+ * the columns [min, max].
+ */
+static inline uint32_t span_mask32(int16_t x0, int16_t min, int16_t max) {
+    uint32_t mask = 0xffffffff;
+    if (max < x0 || min > x0 + 31 || min > max) return 0;
+    if (min > x0) mask <<= (min - x0);
+    if (max - x0 < 31) mask &= 0xffffffff >> (31 - (max - x0));
+    return mask;
+}
+
+static void fctx_resolve_rows_bw(FContext* fctx, GBitmap* fb, int16_t rowMin, int16_t rowMax) {
+
+    uint8_t color;
+#ifdef PBL_COLOR
+    color = fctx->fill_color.argb;
+#else
+    uint8_t gray = 0;
+    if (gcolor_equal(fctx->fill_color, GColorWhite)) {
+        color = 0xff;
+    } else if (gcolor_equal(fctx->fill_color, GColorBlack)) {
+        color = 0x00;
+    } else {
+        gray = 0b01010101;
+        color = gray;
+    }
+#endif
+
+    /* The flag buffer is resolved 32 pixels at a time.  Pebble is little
+     * endian, so bit n of flag word w is the flag for column 32*w + n, which
+     * matches the bit order of the 1-bit frame buffer.
+     */
+    int16_t row;
+    for (row = rowMin; row <= rowMax; ++row) {
+#ifdef PBL_BW
+        if (gray) {
+            if (row & 1) {
+                color = gray;
+            } else {
+                color = ~gray;
+            }
+        }
+        uint32_t color32 = (uint32_t)color * 0x01010101;
+#endif
+        FSpan* span = fctx->flag_spans + (row - fctx->band_top);
+        if (span->min_x > span->max_x) {
+            continue;
+        }
+        GBitmapDataRowInfo fbRowInfo = fctx_frame_row_info(fctx, fb, row);
+        FFlagRow* flagRow = fctx->flag_rows + (row - fctx->band_top);
+
+        /* Every flag on the row lies within the touched span, so parity is
+         * accumulated from the start of the span (including any flags clipped
+         * to the left of a round display).  Flags that close a span beyond the
+         * right edge are never plotted, so if the parity is still odd at the
+         * end of the span, the fill continues to the end of the visible row.
+         */
+        int16_t spanMin = (fbRowInfo.min_x > span->min_x) ? fbRowInfo.min_x : span->min_x;
+        int16_t spanMax = fbRowInfo.max_x;
+
+        uint32_t* src = (uint32_t*)flagRow->data;
+        uint32_t inside = 0;
+        for (int16_t w = span->min_x / 32; w <= span->max_x / 32 || (inside && w <= spanMax / 32); ++w) {
+            int16_t x0 = w * 32;
+            uint32_t fill = prefix_xor32(src[w]) ^ inside;
+            src[w] = 0;
+            inside = (fill & 0x80000000) ? 0xffffffff : 0;
+            fill &= span_mask32(x0, spanMin, spanMax);
+            if (!fill) {
+                continue;
+            }
+#ifdef PBL_COLOR
+            uint8_t* dest = fbRowInfo.data + x0;
+            if (fill == 0xffffffff) {
+                memset(dest, color, 32);
+                continue;
+            }
+            while (fill) {
+                int16_t start = __builtin_ctz(fill);
+                uint32_t run = ~(fill >> start);
+                int16_t length = run ? __builtin_ctz(run) : 32 - start;
+                memset(dest + start, color, length);
+                fill = (start + length < 32) ? fill & (0xffffffff << (start + length)) : 0;
+            }
+#else
+            uint32_t* dest = (uint32_t*)fbRowInfo.data + w;
+            *dest = (color32 & fill) | (*dest & ~fill);
+#endif
+        }
+        fspan_reset(span);
+    }
+
+}
+
+static const FRasterizer k_rasterizer_bw = {
+    .edge = &fctx_rasterize_edge_bw,
+    .circle = &fctx_rasterize_circle_bw,
+    .arc = &fctx_rasterize_arc_bw,
+    .ellipse = &fctx_rasterize_ellipse_bw,
+    .rounded_rect = &fctx_rasterize_rounded_rect_bw,
+    .resolve_rows = &fctx_resolve_rows_bw
+};
+
+void fctx_end_fill_bw(FContext* fctx) {
+    fctx_resolve_bands(fctx, &k_rasterizer_bw);
+}
+
+// --------------------------------------------------------------------------
 // AA - anti-aliased drawing with 8 bit-per-pixel flag buffer.
 // --------------------------------------------------------------------------
 
@@ -399,12 +1198,14 @@ int32_t fceil_aa(fixed_t value) {
  * a scale factor of 2, then we should scan in sub-pixel coordinates, with
  * sub-sub-pixel correct endpoints!  Fukn shweet.
  */
-void edge_init_aa(Edge* e, FPoint* top, FPoint* bottom) {
+void edge_init_aa(Edge* e, FPoint* top, FPoint* bottom, int32_t yMin, int32_t yMax) {
     static const int32_t F = 2;
     e->y = fceil_aa(top->y);
     int32_t yEnd = fceil_aa(bottom->y);
+    if (e->y < yMin) e->y = yMin;
+    if (yEnd > yMax + 1) yEnd = yMax + 1;
     e->height = yEnd - e->y;
-    if (e->height)    {
+    if (e->height > 0)    {
         int32_t dN = bottom->y - top->y;
         int32_t dM = bottom->x - top->x;
         int32_t initialNumerator = dM * F * e->y - dM * top->y +
@@ -415,7 +1216,22 @@ void edge_init_aa(Edge* e, FPoint* top, FPoint* bottom) {
     }
 }
 
-void fctx_init_context_aa(FContext* fctx, GContext* gctx) {
+/* Reset the drawing state to its defaults for AA rendering. */
+static void fctx_init_state_aa(FContext* fctx) {
+    fctx->fill_color = GColorWhite;
+    fctx->color_bias = 0;
+    fctx->subpixel_adjust = -1;
+    fctx->transform_pivot = FPointZero;
+    fctx->transform_offset = FPointZero;
+    fctx->transform_scale_from = FPointOne;
+    fctx->transform_scale_to = FPointOne;
+    fctx->transform_rotation = 0;
+    fctx_update_transform(fctx);
+    fctx->curve_tolerance = FIXED_POINT_SCALE / 4;
+    fctx->edge_capture = NULL;
+}
+
+static void fctx_init_aa(FContext* fctx, GContext* gctx, int16_t band_rows, bool pooled) {
 
     GBitmap* frameBuffer = graphics_capture_frame_buffer(gctx);
     if (frameBuffer) {
@@ -423,85 +1239,102 @@ void fctx_init_context_aa(FContext* fctx, GContext* gctx) {
         fctx->flag_bounds = gbitmap_get_bounds(frameBuffer);
         graphics_release_frame_buffer(gctx, frameBuffer);
         fctx->gctx = gctx;
-        fctx->flag_buffer = gbitmap_create_blank(fctx->flag_bounds.size, format);
-        fctx->fill_color = GColorWhite;
-        fctx->color_bias = 0;
-        fctx->subpixel_adjust = -1;
-        fctx->transform_pivot = FPointZero;
-        fctx->transform_offset = FPointZero;
-        fctx->transform_scale_from = FPointOne;
-        fctx->transform_scale_to = FPointOne;
-        fctx->transform_rotation = 0;
+        fctx_init_band(fctx, band_rows);
+        if (fctx_is_banded(fctx)) {
+            /* A band does not share the row extents of a circular frame. */
+            format = GBitmapFormat8Bit;
+        }
+        fctx_create_flag_buffer(fctx, format, pooled);
+        fctx->frame_buffer = NULL;
+        fctx->frame_rows = NULL;
+        fctx_init_scratch(fctx);
+        fctx->bound = pooled;
+        fctx_init_state_aa(fctx);
     }
 }
 
+void fctx_init_context_aa(FContext* fctx, GContext* gctx) {
+    fctx_init_aa(fctx, gctx, 0, false);
+}
+
 static const int32_t k_sampling_offsets[SUBPIXEL_COUNT] = {
     2, 7, 4, 1, 6, 3, 0, 5 // 1/8ths
 };
 
-void fctx_plot_edge_aa(FContext* fctx, FPoint* a, FPoint* b) {
+static void fctx_rasterize_edge_aa(FContext* fctx, FPoint* a, FPoint* b) {
+
+    /* Edges right of the buffer never plot a flag. */
+    fixed_t right = INT_TO_FIXED(fctx->flag_bounds.size.w + 1);
+    if (a->x >= right && b->x >= right) {
+        return;
+    }
+
+    int32_t top = fctx->band_top * SUBPIXEL_COUNT;
+    int32_t max_y = fctx_band_rows(fctx) * SUBPIXEL_COUNT - 1;
 
     Edge edge;
     if (a->y > b->y) {
-        edge_init_aa(&edge, b, a);
+        edge_init_aa(&edge, b, a, top, top + max_y);
     } else {
-        edge_init_aa(&edge, a, b);
+        edge_init_aa(&edge, a, b, top, top + max_y);
     }
+    edge.y -= top;
 
-    while (edge.height > 0 && edge.y < 0) {
-        edge_step(&edge);
-    }
-
-    int32_t max_y = fctx->flag_bounds.size.h * SUBPIXEL_COUNT - 1;
-    while (edge.height > 0 && edge.y <= max_y) {
+    while (edge.height > 0) {
         int32_t ySub = edge.y & (SUBPIXEL_COUNT - 1);
         uint8_t mask = 1 << ySub;
         int32_t pixelX = (edge.x + k_sampling_offsets[ySub]) / SUBPIXEL_COUNT;
         int32_t pixelY = edge.y / SUBPIXEL_COUNT;
-        GBitmapDataRowInfo row = gbitmap_get_data_row_info(fctx->flag_buffer, pixelY);
-        if (pixelX < row.min_x) {
-            uint8_t* p = row.data + row.min_x;
+        FFlagRow* row = fctx->flag_rows + pixelY;
+        if (pixelX < row->min_x) {
+            uint8_t* p = row->data + row->min_x;
             *p ^= mask;
-        } else if (pixelX <= row.max_x) {
-            uint8_t* p = row.data + pixelX;
+            fspan_touch(fctx->flag_spans + pixelY, row->min_x);
+        } else if (pixelX <= row->max_x) {
+            uint8_t* p = row->data + pixelX;
             *p ^= mask;
+            fspan_touch(fctx->flag_spans + pixelY, pixelX);
         }
         edge_step(&edge);
     }
 }
 
+void fctx_plot_edge_aa(FContext* fctx, FPoint* a, FPoint* b) {
+    if (fctx_is_banded(fctx)) {
+        fctx_record_band(fctx, FBandRecordEdge, *a, *b);
+    } else {
+        fctx_rasterize_edge_aa(fctx, a, b);
+    }
+}
+
 static inline void fctx_plot_point_aa(FContext* fctx, fixed_t x, fixed_t y) {
     int32_t ySub = y & (SUBPIXEL_COUNT - 1);
     uint8_t mask = 1 << ySub;
     int32_t pixelX = (x + k_sampling_offsets[ySub]) / SUBPIXEL_COUNT;
     int32_t pixelY = y / SUBPIXEL_COUNT;
 
-    if (pixelY >= 0 && pixelY < fctx->flag_bounds.size.h) {
-        GBitmapDataRowInfo row = gbitmap_get_data_row_info(fctx->flag_buffer, pixelY);
-        if (pixelX < row.min_x) {
-            uint8_t* p = row.data + row.min_x;
+    if (y >= 0 && pixelY < fctx_band_rows(fctx)) {
+        FFlagRow* row = fctx->flag_rows + pixelY;
+        if (pixelX < row->min_x) {
+            uint8_t* p = row->data + row->min_x;
             *p ^= mask;
-        } else if (pixelX <= row.max_x) {
-            uint8_t* p = row.data + pixelX;
+            fspan_touch(fctx->flag_spans + pixelY, row->min_x);
+        } else if (pixelX <= row->max_x) {
+            uint8_t* p = row->data + pixelX;
             *p ^= mask;
+            fspan_touch(fctx->flag_spans + pixelY, pixelX);
         }
     }
 }
 
-void fctx_plot_circle_aa(FContext* fctx, const FPoint* c, fixed_t r) {
-
-    /* Expand the bounding box of pixels drawn. */
-    if ((c->x-r) < fctx->extent_min.x) fctx->extent_min.x = c->x - r;
-    if ((c->y-r) < fctx->extent_min.y) fctx->extent_min.y = c->y - r;
-    if ((c->x+r) > fctx->extent_max.x) fctx->extent_max.x = c->x + r;
-    if ((c->y+r) > fctx->extent_max.y) fctx->extent_max.y = c->y + r;
+static void fctx_rasterize_circle_aa(FContext* fctx, const FPoint* c, fixed_t r) {
 
     /* Throw away the extra bit of fixed point precision and
      * work directly in subpixels.
      */
     r = r / 2;
     fixed_t cx = c->x / 2;
-    fixed_t cy = c->y / 2;
+    fixed_t cy = c->y / 2 - fctx->band_top * SUBPIXEL_COUNT;
 
     fixed_t m = r - 1;
     fixed_t n = 0;
@@ -538,6 +1371,190 @@ void fctx_plot_circle_aa(FContext* fctx, const FPoint* c, fixed_t r) {
     }
 }
 
+void fctx_plot_circle_aa(FContext* fctx, const FPoint* c, fixed_t r) {
+
+    if (!fctx_circle_visible(fctx, c, r)) {
+        return;
+    }
+
+    /* Expand the bounding box of pixels drawn. */
+    if ((c->x-r) < fctx->extent_min.x) fctx->extent_min.x = c->x - r;
+    if ((c->y-r) < fctx->extent_min.y) fctx->extent_min.y = c->y - r;
+    if ((c->x+r) > fctx->extent_max.x) fctx->extent_max.x = c->x + r;
+    if ((c->y+r) > fctx->extent_max.y) fctx->extent_max.y = c->y + r;
+
+    if (fctx_is_banded(fctx)) {
+        fctx_record_band(fctx, FBandRecordCircle, *c, FPoint(r, 0));
+    } else {
+        fctx_rasterize_circle_aa(fctx, c, r);
+    }
+}
+
+/* Plot the parts of a circle that lie within the given rows, right and left. */
+static void fctx_rasterize_arc_circle_aa(FContext* fctx, fixed_t cx, fixed_t cy, fixed_t r, const FArcRows rows[2]) {
+
+    fixed_t m = r - 1;
+    fixed_t n = 0;
+    fixed_t E = 1 - 2*r;
+    while (m >= n) {
+
+        if (farc_rows_contain(&rows[0], cy+n))   fctx_plot_point_aa(fctx, cx+m+1, cy+n);
+        if (farc_rows_contain(&rows[0], cy-n-1)) fctx_plot_point_aa(fctx, cx+m+1, cy-n-1);
+        if (farc_rows_contain(&rows[1], cy+n))   fctx_plot_point_aa(fctx, cx-m-1, cy+n);
+        if (farc_rows_contain(&rows[1], cy-n-1)) fctx_plot_point_aa(fctx, cx-m-1, cy-n-1);
+
+        E += 4*n + 4;
+        if (E > 0) {
+            /* As for circles, plot the reflected octants only on a step. */
+            if (m != n) {
+                if (farc_rows_contain(&rows[0], cy+m))   fctx_plot_point_aa(fctx, cx+n+1, cy+m);
+                if (farc_rows_contain(&rows[0], cy-m-1)) fctx_plot_point_aa(fctx, cx+n+1, cy-m-1);
+                if (farc_rows_contain(&rows[1], cy+m))   fctx_plot_point_aa(fctx, cx-n-1, cy+m);
+                if (farc_rows_contain(&rows[1], cy-m-1)) fctx_plot_point_aa(fctx, cx-n-1, cy-m-1);
+            }
+            E += -4*m;
+            --m;
+        }
+        ++n;
+    }
+}
+
+static void fctx_rasterize_arc_aa(FContext* fctx, const FPoint* c, fixed_t inner_r, fixed_t outer_r,
+                                  int32_t start, int32_t end) {
+
+    /* A full ring is just its two circles. */
+    if (end - start >= TRIG_MAX_ANGLE) {
+        fctx_rasterize_circle_aa(fctx, c, outer_r);
+        fctx_rasterize_circle_aa(fctx, c, inner_r);
+        return;
+    }
+
+    /* Work in subpixels, as for circles. */
+    fixed_t ri = inner_r / 2;
+    fixed_t ro = outer_r / 2;
+    fixed_t cx = c->x / 2;
+    fixed_t cy = c->y / 2;
+    int32_t top = fctx->band_top * SUBPIXEL_COUNT;
+    FPoint e = FPoint(cx * FIXED_POINT_SCALE_AA - FIXED_POINT_SCALE_AA / 2, cy * FIXED_POINT_SCALE_AA - FIXED_POINT_SCALE_AA / 2);
+
+    FArcRows rows[2];
+    farc_rows(rows, &e, ro * FIXED_POINT_SCALE_AA, start, end, FIXED_POINT_SCALE_AA, top);
+    fctx_rasterize_arc_circle_aa(fctx, cx, cy - top, ro, rows);
+    if (ri > 0) {
+        farc_rows(rows, &e, ri * FIXED_POINT_SCALE_AA, start, end, FIXED_POINT_SCALE_AA, top);
+        fctx_rasterize_arc_circle_aa(fctx, cx, cy - top, ri, rows);
+    }
+
+    FPoint a = farc_point(&e, ri * FIXED_POINT_SCALE_AA, start);
+    FPoint b = farc_point(&e, ro * FIXED_POINT_SCALE_AA, start);
+    fctx_rasterize_edge_aa(fctx, &a, &b);
+    a = farc_point(&e, ri * FIXED_POINT_SCALE_AA, end);
+    b = farc_point(&e, ro * FIXED_POINT_SCALE_AA, end);
+    fctx_rasterize_edge_aa(fctx, &a, &b);
+}
+
+void fctx_plot_arc_aa(FContext* fctx, const FPoint* c, fixed_t inner_r, fixed_t outer_r,
+                      int32_t start_angle, int32_t end_angle) {
+
+    if (inner_r < 0) inner_r = 0;
+    if (outer_r <= inner_r || !farc_normalize(&start_angle, &end_angle)) {
+        return;
+    }
+    if (!fctx_circle_visible(fctx, c, outer_r)) {
+        return;
+    }
+
+    fctx_expand_extent(fctx, c->x - outer_r, c->y - outer_r, c->x + outer_r, c->y + outer_r);
+
+    if (fctx_is_banded(fctx)) {
+        fctx_record_band_params(fctx, FBandRecordArc, *c, FPoint(outer_r, inner_r), FPoint(start_angle, end_angle));
+    } else {
+        fctx_rasterize_arc_aa(fctx, c, inner_r, outer_r, start_angle, end_angle);
+    }
+}
+
+static void fctx_rasterize_ellipse_aa(FContext* fctx, const FPoint* c, fixed_t frx, fixed_t fry) {
+
+    /* Work in subpixels, as for circles. */
+    fixed_t rx = frx / 2;
+    fixed_t ry = fry / 2;
+    fixed_t cx = c->x / 2;
+    fixed_t cy = c->y / 2 - fctx->band_top * SUBPIXEL_COUNT;
+    if (rx <= 0 || ry <= 0) {
+        return;
+    }
+
+    FEllipseStepper e;
+    fellipse_init(&e, rx, ry);
+    for (fixed_t n = ry - 1; n >= 0; --n) {
+        fixed_t w = fellipse_step(&e);
+        fctx_plot_point_aa(fctx, cx-w, cy+n);
+        fctx_plot_point_aa(fctx, cx+w, cy+n);
+        fctx_plot_point_aa(fctx, cx-w, cy-n-1);
+        fctx_plot_point_aa(fctx, cx+w, cy-n-1);
+    }
+}
+
+void fctx_plot_ellipse_aa(FContext* fctx, const FPoint* c, fixed_t rx, fixed_t ry) {
+
+    if (!fctx_box_visible(fctx, c->x - rx, c->y - ry, c->x + rx, c->y + ry)) {
+        return;
+    }
+    fctx_expand_extent(fctx, c->x - rx, c->y - ry, c->x + rx, c->y + ry);
+
+    if (fctx_is_banded(fctx)) {
+        fctx_record_band(fctx, FBandRecordEllipse, *c, FPoint(rx, ry));
+    } else {
+        fctx_rasterize_ellipse_aa(fctx, c, rx, ry);
+    }
+}
+
+static void fctx_rasterize_rounded_rect_aa(FContext* fctx, const FRect* rect, fixed_t fr) {
+
+    /* Work in subpixels, as for circles. */
+    int32_t top = fctx->band_top * SUBPIXEL_COUNT;
+    fixed_t x0 = rect->origin.x / 2;
+    fixed_t y0 = rect->origin.y / 2 - top;
+    fixed_t x1 = (rect->origin.x + rect->size.w) / 2;
+    fixed_t y1 = (rect->origin.y + rect->size.h) / 2 - top;
+    fixed_t r = fr / 2;
+    if (r > (x1 - x0) / 2) r = (x1 - x0) / 2;
+    if (r > (y1 - y0) / 2) r = (y1 - y0) / 2;
+
+    if (r > 0) {
+        FEllipseStepper e;
+        fellipse_init(&e, r, r);
+        for (fixed_t n = r - 1; n >= 0; --n) {
+            fixed_t inset = r - fellipse_step(&e);
+            fctx_plot_point_aa(fctx, x0+inset, y0+r-n-1);
+            fctx_plot_point_aa(fctx, x1-inset, y0+r-n-1);
+            fctx_plot_point_aa(fctx, x0+inset, y1-r+n);
+            fctx_plot_point_aa(fctx, x1-inset, y1-r+n);
+        }
+    }
+    for (fixed_t y = y0 + r; y < y1 - r; ++y) {
+        fctx_plot_point_aa(fctx, x0, y);
+        fctx_plot_point_aa(fctx, x1, y);
+    }
+}
+
+void fctx_plot_rounded_rect_aa(FContext* fctx, const FRect* rect, fixed_t r) {
+
+    fixed_t x1 = rect->origin.x + rect->size.w;
+    fixed_t y1 = rect->origin.y + rect->size.h;
+    if (rect->size.w <= 0 || rect->size.h <= 0 || !fctx_box_visible(fctx, rect->origin.x, rect->origin.y, x1, y1)) {
+        return;
+    }
+    fctx_expand_extent(fctx, rect->origin.x, rect->origin.y, x1, y1);
+
+    if (fctx_is_banded(fctx)) {
+        fctx_record_band_params(fctx, FBandRecordRoundedRect, rect->origin, FPoint(rect->size.w, rect->size.h),
+                                FPoint(r, 0));
+    } else {
+        fctx_rasterize_rounded_rect_aa(fctx, rect, r);
+    }
+}
+
 // count the number of bits set in v
 uint8_t countBits(uint8_t v) {
     unsigned int c; // c accumulates the total bits set in v
@@ -553,56 +1570,133 @@ static inline int8_t clamp8(int8_t val, int8_t min, int8_t max) {
     return val;
 }
 
-void fctx_end_fill_aa(FContext* fctx) {
+/*
+ * Resolve tables.  The coverage table maps an accumulated subpixel mask to
+ * a coverage value with the color bias already applied.  The blend table
+ * maps a coverage value and the rgb bits of a destination pixel to the
+ * blended rgb bits for the fill color.  They are rebuilt only when the
+ * fill color or bias differ from the previous fill.
+ */
+static uint8_t s_coverage_table[256];
+static uint8_t s_blend_table[SUBPIXEL_COUNT + 1][64];
+static int16_t s_table_bias;
+static GColor8 s_table_color;
+static bool s_tables_valid = false;
 
-    int16_t rowMin = FIXED_TO_INT(fctx->extent_min.y);
-    int16_t rowMax = FIXED_TO_INT(fctx->extent_max.y);
-    int16_t colMin = FIXED_TO_INT(fctx->extent_min.x);
-    int16_t colMax = FIXED_TO_INT(fctx->extent_max.x);
+static void build_resolve_tables(GColor8 s, int16_t bias) {
 
-    if (rowMin < 0) rowMin = 0;
-    if (rowMax >= fctx->flag_bounds.size.h) rowMax = fctx->flag_bounds.size.h - 1;
+    if (s_tables_valid && s_table_bias == bias && gcolor_equal(s_table_color, s)) {
+        return;
+    }
 
-    GBitmap* fb = graphics_capture_frame_buffer(fctx->gctx);
+    for (uint16_t mask = 0; mask < 256; ++mask) {
+        s_coverage_table[mask] = clamp8(countBits(mask) + bias, 0, SUBPIXEL_COUNT);
+    }
+
+    GColor8 d;
+    for (uint8_t a = 0; a <= SUBPIXEL_COUNT; ++a) {
+        for (uint8_t rgb = 0; rgb < 64; ++rgb) {
+            d.argb = rgb;
+            d.r = (s.r*a + d.r*(8 - a) + 4) / 8;
+            d.g = (s.g*a + d.g*(8 - a) + 4) / 8;
+            d.b = (s.b*a + d.b*(8 - a) + 4) / 8;
+            s_blend_table[a][rgb] = d.argb;
+        }
+    }
+
+    s_table_bias = bias;
+    s_table_color = s;
+    s_tables_valid = true;
+}
+
+static void fctx_resolve_rows_aa(FContext* fctx, GBitmap* fb, int16_t rowMin, int16_t rowMax) {
+
+    const uint8_t* coverage = s_coverage_table;
+    const uint8_t solid = s_blend_table[SUBPIXEL_COUNT][0];
 
     int16_t col, row;
 
-    GColor8 d;
-    GColor8 s = fctx->fill_color;
-    int16_t bias = fctx->color_bias;
     for (row = rowMin; row <= rowMax; ++row) {
-        GBitmapDataRowInfo fbRowInfo = gbitmap_get_data_row_info(fb, row);
-        GBitmapDataRowInfo flagRowInfo = gbitmap_get_data_row_info(fctx->flag_buffer, row);
-        int16_t spanMin = (fbRowInfo.min_x > colMin) ? fbRowInfo.min_x : colMin;
-        int16_t spanMax = (fbRowInfo.max_x < colMax) ? fbRowInfo.max_x : colMax;
-        uint8_t* dest = fbRowInfo.data + spanMin;
-        uint8_t* src = flagRowInfo.data + spanMin;
+        FSpan* span = fctx->flag_spans + (row - fctx->band_top);
+        if (span->min_x > span->max_x) {
+            continue;
+        }
+        GBitmapDataRowInfo fbRowInfo = fctx_frame_row_info(fctx, fb, row);
+        FFlagRow* flagRow = fctx->flag_rows + (row - fctx->band_top);
+        int16_t spanMin = (fbRowInfo.min_x > span->min_x) ? fbRowInfo.min_x : span->min_x;
+        int16_t spanMax = (fbRowInfo.max_x < span->max_x) ? fbRowInfo.max_x : span->max_x;
+        uint8_t* src = flagRow->data + span->min_x;
 
+        /* Accumulate any flags left of the visible part of the row. */
         uint8_t mask = 0;
+        for (col = span->min_x; col < spanMin; ++col, ++src) {
+            mask ^= *src;
+            *src = 0;
+        }
+
+        uint8_t* dest = fbRowInfo.data + spanMin;
         for (col = spanMin; col <= spanMax; ++col, ++dest, ++src) {
 
             mask ^= *src;
             *src = 0;
-            uint8_t a = clamp8(countBits(mask) + bias, 0, 8);
+            uint8_t a = coverage[mask];
+            if (a == SUBPIXEL_COUNT) {
+                /* Fully covered; write the solid color until the next
+                 * non-zero flag byte.  Only the destination alpha is kept.
+                 */
+                *dest = (*dest & 0xc0) | solid;
+                while (col < spanMax && src[1] == 0) {
+                    ++col, ++dest, ++src;
+                    *dest = (*dest & 0xc0) | solid;
+                }
+            } else if (a) {
+                *dest = (*dest & 0xc0) | s_blend_table[a][*dest & 0x3f];
+            }
+        }
+
+        if (col <= span->max_x) {
+            /* Clear any flags right of the visible part of the row. */
+            for (; col <= span->max_x; ++col, ++src) {
+                *src = 0;
+            }
+        } else if (mask) {
+            /* The span is closed beyond the right edge, so the coverage
+             * holds to the end of the visible row.
+             */
+            uint8_t a = coverage[mask];
             if (a) {
-                d.argb = *dest;
-                d.r = (s.r*a + d.r*(8 - a) + 4) / 8;
-                d.g = (s.g*a + d.g*(8 - a) + 4) / 8;
-                d.b = (s.b*a + d.b*(8 - a) + 4) / 8;
-                *dest = d.argb;
+                const uint8_t* blend = s_blend_table[a];
+                for (; col <= fbRowInfo.max_x; ++col, ++dest) {
+                    *dest = (*dest & 0xc0) | blend[*dest & 0x3f];
+                }
             }
         }
-        if (col < flagRowInfo.max_x) *src = 0;
+        fspan_reset(span);
     }
 
-    graphics_release_frame_buffer(fctx->gctx, fb);
+}
+
+static const FRasterizer k_rasterizer_aa = {
+    .edge = &fctx_rasterize_edge_aa,
+    .circle = &fctx_rasterize_circle_aa,
+    .arc = &fctx_rasterize_arc_aa,
+    .ellipse = &fctx_rasterize_ellipse_aa,
+    .rounded_rect = &fctx_rasterize_rounded_rect_aa,
+    .resolve_rows = &fctx_resolve_rows_aa
+};
 
+void fctx_end_fill_aa(FContext* fctx) {
+    build_resolve_tables(fctx->fill_color, fctx->color_bias);
+    fctx_resolve_bands(fctx, &k_rasterizer_aa);
 }
 
 // Initialize for Anti-Aliased rendering.
 fctx_init_context_func   fctx_init_context   = &fctx_init_context_aa;
 fctx_plot_edge_func      fctx_plot_edge      = &fctx_plot_edge_aa;
 fctx_plot_circle_func    fctx_plot_circle    = &fctx_plot_circle_aa;
+fctx_plot_arc_func       fctx_plot_arc       = &fctx_plot_arc_aa;
+fctx_plot_ellipse_func   fctx_plot_ellipse   = &fctx_plot_ellipse_aa;
+fctx_plot_rounded_rect_func fctx_plot_rounded_rect = &fctx_plot_rounded_rect_aa;
 fctx_end_fill_func       fctx_end_fill       = &fctx_end_fill_aa;
 
 void fctx_enable_aa(bool enable) {
@@ -610,11 +1704,17 @@ void fctx_enable_aa(bool enable) {
         fctx_init_context   = &fctx_init_context_aa;
         fctx_plot_edge      = &fctx_plot_edge_aa;
         fctx_plot_circle    = &fctx_plot_circle_aa;
+        fctx_plot_arc       = &fctx_plot_arc_aa;
+        fctx_plot_ellipse   = &fctx_plot_ellipse_aa;
+        fctx_plot_rounded_rect = &fctx_plot_rounded_rect_aa;
         fctx_end_fill       = &fctx_end_fill_aa;
     } else {
         fctx_init_context   = &fctx_init_context_bw;
         fctx_plot_edge      = &fctx_plot_edge_bw;
         fctx_plot_circle    = &fctx_plot_circle_bw;
+        fctx_plot_arc       = &fctx_plot_arc_bw;
+        fctx_plot_ellipse   = &fctx_plot_ellipse_bw;
+        fctx_plot_rounded_rect = &fctx_plot_rounded_rect_bw;
         fctx_end_fill       = &fctx_end_fill_bw;
     }
 }
@@ -629,104 +1729,351 @@ bool fctx_is_aa_enabled() {
 fctx_init_context_func   fctx_init_context   = &fctx_init_context_bw;
 fctx_plot_edge_func      fctx_plot_edge      = &fctx_plot_edge_bw;
 fctx_plot_circle_func    fctx_plot_circle    = &fctx_plot_circle_bw;
+fctx_plot_arc_func       fctx_plot_arc       = &fctx_plot_arc_bw;
+fctx_plot_ellipse_func   fctx_plot_ellipse   = &fctx_plot_ellipse_bw;
+fctx_plot_rounded_rect_func fctx_plot_rounded_rect = &fctx_plot_rounded_rect_bw;
 fctx_end_fill_func       fctx_end_fill       = &fctx_end_fill_bw;
 
 #endif
 
-// --------------------------------------------------------------------------
-// Transformed Drawing
-// --------------------------------------------------------------------------
+void fctx_plot_ring(FContext* fctx, const FPoint* c, fixed_t inner_r, fixed_t outer_r) {
+    fctx_plot_arc(fctx, c, inner_r, outer_r, 0, TRIG_MAX_ANGLE);
+}
+
+void fctx_plot_sector(FContext* fctx, const FPoint* c, fixed_t r, int32_t start_angle, int32_t end_angle) {
+    fctx_plot_arc(fctx, c, 0, r, start_angle, end_angle);
+}
 
-static void bezier(FContext* fctx,
-            fixed_t x1, fixed_t y1,
-            fixed_t x2, fixed_t y2,
-            fixed_t x3, fixed_t y3,
-            fixed_t x4, fixed_t y4) {
-
-    // Angle below which we're not going to process with recursion
-    static const int32_t max_angle_tolerance = (TRIG_MAX_ANGLE / 360) * 5;
-
-    // Calculate all the mid-points of the line segments
-    fixed_t x12   = (x1 + x2) / 2;
-    fixed_t y12   = (y1 + y2) / 2;
-    fixed_t x23   = (x2 + x3) / 2;
-    fixed_t y23   = (y2 + y3) / 2;
-    fixed_t x34   = (x3 + x4) / 2;
-    fixed_t y34   = (y3 + y4) / 2;
-    fixed_t x123  = (x12 + x23) / 2;
-    fixed_t y123  = (y12 + y23) / 2;
-    fixed_t x234  = (x23 + x34) / 2;
-    fixed_t y234  = (y23 + y34) / 2;
-    fixed_t x1234 = (x123 + x234) / 2;
-    fixed_t y1234 = (y123 + y234) / 2;
-
-    // Angle Condition
-    int32_t a23 = atan2_lookup((int16_t)((y3 - y2) / FIXED_POINT_SCALE),
-                               (int16_t)((x3 - x2) / FIXED_POINT_SCALE));
-    int32_t da1 = abs(a23 - atan2_lookup((int16_t)((y2 - y1) / FIXED_POINT_SCALE),
-                                         (int16_t)((x2 - x1) / FIXED_POINT_SCALE)));
-    int32_t da2 = abs(atan2_lookup((int16_t)((y4 - y3) / FIXED_POINT_SCALE),
-                                   (int16_t)((x4 - x3) / FIXED_POINT_SCALE)) - a23);
-
-    if (da1 >= TRIG_MAX_ANGLE) {
-        da1 = TRIG_MAX_ANGLE - da1;
-    }
-
-    if (da2 >= TRIG_MAX_ANGLE) {
-        da2 = TRIG_MAX_ANGLE - da2;
-    }
-
-    if (da1 + da2 < max_angle_tolerance) {
-        // Finally we can stop the recursion
-        FPoint a = {x1, y1};
-        FPoint b = {x4, y4};
-        fctx_plot_edge(fctx, &a, &b);
+/* Initialize for the current mode, taking the flag buffer from the pool if
+ * pooled.
+ */
+static void fctx_init_mode(FContext* fctx, GContext* gctx, int16_t band_rows, bool pooled) {
+#ifdef PBL_COLOR
+    if (fctx_is_aa_enabled()) {
+        fctx_init_aa(fctx, gctx, band_rows, pooled);
         return;
     }
-
-    // Continue subdivision if points are being added successfully
-    bezier(fctx, x1, y1, x12, y12, x123, y123, x1234, y1234);
-    bezier(fctx, x1234, y1234, x234, y234, x34, y34, x4, y4);
-
+#endif
+    fctx_init_bw(fctx, gctx, band_rows, pooled);
 }
 
-void fctx_move_to_func(FContext* fctx, FPoint* params) {
-    fctx->path_init_point = params[0];
-    fctx->path_cur_point = params[0];
+void fctx_init_context_banded(FContext* fctx, GContext* gctx, int16_t band_rows) {
+    fctx_init_mode(fctx, gctx, band_rows, false);
 }
 
-void fctx_line_to_func(FContext* fctx, FPoint* params) {
-    fctx_plot_edge(fctx, &fctx->path_cur_point, params + 0);
+// --------------------------------------------------------------------------
+// Persistent contexts
+// --------------------------------------------------------------------------
+
+/* Whether the bound flag buffer suits the current mode and band height. */
+static bool fctx_binding_matches(FContext* fctx) {
+    bool bw = gbitmap_get_format(fctx->flag_buffer) == GBitmapFormat1Bit;
+#ifdef PBL_COLOR
+    if (bw == fctx_is_aa_enabled()) {
+        return false;
+    }
+#else
+    if (!bw) {
+        return false;
+    }
+#endif
+    return fctx->band_height == fctx_band_height_for(fctx, fctx->band_rows);
+}
+
+void fctx_bind_context(FContext* fctx, GContext* gctx) {
+
+    if (fctx->bound && fctx->flag_buffer && fctx_binding_matches(fctx)) {
+        fctx->gctx = gctx;
+        fctx->band_record_count = 0;
+#ifdef PBL_COLOR
+        if (fctx_is_aa_enabled()) {
+            fctx_init_state_aa(fctx);
+            return;
+        }
+#endif
+        fctx_init_state_bw(fctx);
+        return;
+    }
+
+    /* Keep a scratch size set before binding, or on an earlier binding. */
+    bool scratch_sized = fctx->scratch_sized;
+    uint16_t scratch_size = fctx->scratch_size;
+    int16_t band_rows = fctx->band_rows;
+    /* Release whatever buffer the context has, whether from an earlier
+     * binding or from fctx_init_context. */
+    fctx_deinit_context(fctx);
+    fctx_init_mode(fctx, gctx, band_rows, true);
+    if (scratch_sized) {
+        fctx_set_scratch_size(fctx, scratch_size);
+    }
+}
+
+// --------------------------------------------------------------------------
+// Transformed Drawing
+// --------------------------------------------------------------------------
+
+/* Copy an edge into the cache being captured, growing its extents. */
+static void fedge_cache_record(FEdgeCache* cache, const FPoint* a, const FPoint* b) {
+    if (cache->edge_count < cache->edge_capacity) {
+        FPoint* e = cache->edges + 2 * cache->edge_count++;
+        e[0] = *a;
+        e[1] = *b;
+        for (int k = 0; k < 2; ++k) {
+            if (e[k].x < cache->extent_min.x) cache->extent_min.x = e[k].x;
+            if (e[k].y < cache->extent_min.y) cache->extent_min.y = e[k].y;
+            if (e[k].x > cache->extent_max.x) cache->extent_max.x = e[k].x;
+            if (e[k].y > cache->extent_max.y) cache->extent_max.y = e[k].y;
+        }
+    } else {
+        cache->valid = false;
+    }
+}
+
+/* Plot one edge of a path, copying it into the context's edge capture, if any. */
+static inline void fctx_path_edge(FContext* fctx, FPoint* a, FPoint* b) {
+    if (fctx->edge_capture) {
+        fedge_cache_record(fctx->edge_capture, a, b);
+    }
+    fctx_plot_edge(fctx, a, b);
+}
+
+/*
+ * Curves are flattened in device space, after the transform has been applied,
+ * into 2^k line segments by forward differencing.  The segment count comes from
+ * Wang's formula: a polynomial curve of degree d lies within the tolerance of
+ * its n segment polyline when
+ *     n * n >= d * (d - 1) / 8 * M / tolerance
+ * where M is the length of the largest second difference of the control points.
+ */
+#define BEZIER_MAX_SHIFT 6
+
+/* Approximate vector length; never less than the true length, and at most
+ * 12% more.
+ */
+static inline fixed_t fixed_length_approx(fixed_t dx, fixed_t dy) {
+    if (dx < 0) dx = -dx;
+    if (dy < 0) dy = -dy;
+    return (dx > dy) ? dx + dy / 2 : dy + dx / 2;
+}
+
+/* Smallest k, up to BEZIER_MAX_SHIFT, such that 4^k * denominator >= numerator. */
+static uint8_t bezier_segment_shift(int32_t numerator, int32_t denominator) {
+    uint8_t k = 0;
+    while (k < BEZIER_MAX_SHIFT && ((int64_t)denominator << (2 * k)) < numerator) {
+        ++k;
+    }
+    return k;
+}
+
+/* Forward differencing state for flattening one curve into 2^k segments.  The
+ * differences are scaled by 2^shift so that they are exact integers.
+ */
+typedef struct FBezierStepper {
+    int64_t fx, fy;
+    int64_t dfx, dfy;
+    int64_t ddfx, ddfy;
+    int64_t dddfx, dddfy;
+    int64_t half;
+    uint8_t shift;
+} FBezierStepper;
+
+/* Start stepping a cubic curve; returns the segment count. */
+static uint16_t fbezier_init_cubic(FBezierStepper* s, const FPoint* p0, const FPoint* p1,
+                                   const FPoint* p2, const FPoint* p3, fixed_t tolerance) {
+
+    fixed_t m1 = fixed_length_approx(p0->x - 2 * p1->x + p2->x, p0->y - 2 * p1->y + p2->y);
+    fixed_t m2 = fixed_length_approx(p1->x - 2 * p2->x + p3->x, p1->y - 2 * p2->y + p3->y);
+    uint8_t k = bezier_segment_shift(3 * ((m1 > m2) ? m1 : m2), 4 * tolerance);
+
+    /* Polynomial coefficients, B(t) = a*t^3 + b*t^2 + c*t + p0. */
+    int64_t ax = -p0->x + 3 * p1->x - 3 * p2->x + p3->x;
+    int64_t ay = -p0->y + 3 * p1->y - 3 * p2->y + p3->y;
+    int64_t bx = 3 * p0->x - 6 * p1->x + 3 * p2->x;
+    int64_t by = 3 * p0->y - 6 * p1->y + 3 * p2->y;
+    int64_t cx = 3 * (p1->x - p0->x);
+    int64_t cy = 3 * (p1->y - p0->y);
+
+    /* Forward differences for a step of 2^-k, scaled by 2^3k. */
+    s->shift = 3 * k;
+    s->half = ((int64_t)1 << s->shift) >> 1;
+    s->fx = p0->x * ((int64_t)1 << s->shift);
+    s->fy = p0->y * ((int64_t)1 << s->shift);
+    s->dfx = ax + bx * (1 << k) + cx * (1 << (2 * k));
+    s->dfy = ay + by * (1 << k) + cy * (1 << (2 * k));
+    s->ddfx = 6 * ax + 2 * bx * (1 << k);
+    s->ddfy = 6 * ay + 2 * by * (1 << k);
+    s->dddfx = 6 * ax;
+    s->dddfy = 6 * ay;
+    return 1 << k;
+}
+
+/* Start stepping a quadratic curve; returns the segment count. */
+static uint16_t fbezier_init_quad(FBezierStepper* s, const FPoint* p0, const FPoint* p1,
+                                  const FPoint* p2, fixed_t tolerance) {
+
+    fixed_t m = fixed_length_approx(p0->x - 2 * p1->x + p2->x, p0->y - 2 * p1->y + p2->y);
+    uint8_t k = bezier_segment_shift(m, 4 * tolerance);
+
+    /* Polynomial coefficients, B(t) = a*t^2 + b*t + p0. */
+    int64_t ax = p0->x - 2 * p1->x + p2->x;
+    int64_t ay = p0->y - 2 * p1->y + p2->y;
+    int64_t bx = 2 * (p1->x - p0->x);
+    int64_t by = 2 * (p1->y - p0->y);
+
+    /* Forward differences for a step of 2^-k, scaled by 2^2k. */
+    s->shift = 2 * k;
+    s->half = ((int64_t)1 << s->shift) >> 1;
+    s->fx = p0->x * ((int64_t)1 << s->shift);
+    s->fy = p0->y * ((int64_t)1 << s->shift);
+    s->dfx = ax + bx * (1 << k);
+    s->dfy = ay + by * (1 << k);
+    s->ddfx = 2 * ax;
+    s->ddfy = 2 * ay;
+    s->dddfx = 0;
+    s->dddfy = 0;
+    return 1 << k;
+}
+
+/* Advance to the next point on the curve.  For n segments, call n - 1 times
+ * and finish at the end point, which is exact.
+ */
+static inline FPoint fbezier_step(FBezierStepper* s) {
+    s->fx += s->dfx;
+    s->fy += s->dfy;
+    s->dfx += s->ddfx;
+    s->dfy += s->ddfy;
+    s->ddfx += s->dddfx;
+    s->ddfy += s->dddfy;
+    return FPoint((fixed_t)((s->fx + s->half) >> s->shift), (fixed_t)((s->fy + s->half) >> s->shift));
+}
+
+static void bezier(FContext* fctx, const FPoint* p0, const FPoint* p1, const FPoint* p2, const FPoint* p3) {
+
+    FBezierStepper s;
+    uint16_t n = fbezier_init_cubic(&s, p0, p1, p2, p3, fctx->curve_tolerance);
+    FPoint a = *p0;
+    FPoint b;
+    for (uint16_t i = 1; i < n; ++i) {
+        b = fbezier_step(&s);
+        fctx_path_edge(fctx, &a, &b);
+        a = b;
+    }
+    b = *p3;
+    fctx_path_edge(fctx, &a, &b);
+}
+
+static void quadratic_bezier(FContext* fctx, const FPoint* p0, const FPoint* p1, const FPoint* p2) {
+
+    FBezierStepper s;
+    uint16_t n = fbezier_init_quad(&s, p0, p1, p2, fctx->curve_tolerance);
+    FPoint a = *p0;
+    FPoint b;
+    for (uint16_t i = 1; i < n; ++i) {
+        b = fbezier_step(&s);
+        fctx_path_edge(fctx, &a, &b);
+        a = b;
+    }
+    b = *p2;
+    fctx_path_edge(fctx, &a, &b);
+}
+
+void fctx_move_to_func(FContext* fctx, FPoint* params) {
+    fctx->path_init_point = params[0];
+    fctx->path_cur_point = params[0];
+}
+
+void fctx_line_to_func(FContext* fctx, FPoint* params) {
+    fctx_path_edge(fctx, &fctx->path_cur_point, params + 0);
     fctx->path_cur_point = params[0];
 }
 
 void fctx_curve_to_func(FContext* fctx, FPoint* params) {
-    bezier(fctx,
-           fctx->path_cur_point.x, fctx->path_cur_point.y,
-           params[0].x, params[0].y,
-           params[1].x, params[1].y,
-           params[2].x, params[2].y);
+    bezier(fctx, &fctx->path_cur_point, params + 0, params + 1, params + 2);
     fctx->path_cur_point = params[2];
 }
 
+void fctx_quad_to_func(FContext* fctx, FPoint* params) {
+    quadratic_bezier(fctx, &fctx->path_cur_point, params + 0, params + 1);
+    fctx->path_cur_point = params[1];
+}
+
 typedef void (*fctx_draw_cmd_func)(FContext* fctx, FPoint* params);
 
-void fctx_transform_points(FContext* fctx, uint16_t pcount, FPoint* ppoints, FPoint* tpoints, FPoint advance) {
+/* Rounded quotient of trig * to / (TRIG_MAX_RATIO * from), with FMATRIX_SHIFT
+ * fractional bits.
+ */
+static int32_t fmatrix_term(int32_t trig, int32_t to, int32_t from) {
+    int64_t n = (int64_t)trig * to * ((int64_t)1 << FMATRIX_SHIFT);
+    int64_t d = (int64_t)TRIG_MAX_RATIO * from;
+    if (d < 0) {
+        n = -n;
+        d = -d;
+    }
+    return (int32_t)((n >= 0) ? (n + d / 2) / d : -((-n + d / 2) / d));
+}
+
+/* Fold pivot, scale, rotation and offset into the transform matrix. */
+static void fctx_update_transform(FContext* fctx) {
 
     int32_t c = cos_lookup(fctx->transform_rotation);
     int32_t s = sin_lookup(fctx->transform_rotation);
+    FPoint from = fctx->transform_scale_from;
+    FPoint to = fctx->transform_scale_to;
+    FPoint pivot = fctx->transform_pivot;
+
+    FMatrix* m = &fctx->transform_matrix;
+    m->a = fmatrix_term(c, to.x, from.x);
+    m->b = fmatrix_term(s, to.x, from.x);
+    m->c = fmatrix_term(-s, to.y, from.y);
+    m->d = fmatrix_term(c, to.y, from.y);
+
+    /* The translation carries the rounding bias for the final shift. */
+    int64_t half = (int64_t)1 << (FMATRIX_SHIFT - 1);
+    m->tx = (int64_t)(fctx->transform_offset.x + fctx->subpixel_adjust) * ((int64_t)1 << FMATRIX_SHIFT) + half
+          - ((int64_t)m->a * pivot.x + (int64_t)m->c * pivot.y);
+    m->ty = (int64_t)(fctx->transform_offset.y + fctx->subpixel_adjust) * ((int64_t)1 << FMATRIX_SHIFT) + half
+          - ((int64_t)m->b * pivot.x + (int64_t)m->d * pivot.y);
+
+    FTransformKey* k = &fctx->transform_key;
+    k->pivot = pivot;
+    k->offset = fctx->transform_offset;
+    k->scale_from = from;
+    k->scale_to = to;
+    k->rotation = fctx->transform_rotation;
+    k->subpixel_adjust = fctx->subpixel_adjust;
+}
+
+/* Rebuild the matrix if the transform fields have changed since it was
+ * built, whether through the setters or by assignment.
+ */
+static inline void fctx_refresh_transform(FContext* fctx) {
+    const FTransformKey* k = &fctx->transform_key;
+    if (k->rotation != fctx->transform_rotation || k->subpixel_adjust != fctx->subpixel_adjust
+        || !fpoint_equal(&k->pivot, &fctx->transform_pivot)
+        || !fpoint_equal(&k->offset, &fctx->transform_offset)
+        || !fpoint_equal(&k->scale_from, &fctx->transform_scale_from)
+        || !fpoint_equal(&k->scale_to, &fctx->transform_scale_to)) {
+        fctx_update_transform(fctx);
+    }
+}
+
+void fctx_transform_points(FContext* fctx, uint16_t pcount, FPoint* ppoints, FPoint* tpoints, FPoint advance) {
+
+    fctx_refresh_transform(fctx);
+
+    const FMatrix* m = &fctx->transform_matrix;
+    int64_t tx = m->tx + (int64_t)m->a * advance.x + (int64_t)m->c * advance.y;
+    int64_t ty = m->ty + (int64_t)m->b * advance.x + (int64_t)m->d * advance.y;
 
     /* transform the parameters */
     FPoint* src = ppoints;
     FPoint* dst = tpoints;
     FPoint* end = dst + pcount;
     while (dst != end) {
-        fixed_t x = (src->x - fctx->transform_pivot.x + advance.x) * fctx->transform_scale_to.x / fctx->transform_scale_from.x;
-        fixed_t y = (src->y - fctx->transform_pivot.y + advance.y) * fctx->transform_scale_to.y / fctx->transform_scale_from.y;
-        dst->x = (x * c / TRIG_MAX_RATIO) - (y * s / TRIG_MAX_RATIO);
-        dst->y = (x * s / TRIG_MAX_RATIO) + (y * c / TRIG_MAX_RATIO);
-        dst->x += fctx->transform_offset.x + fctx->subpixel_adjust;
-        dst->y += fctx->transform_offset.y + fctx->subpixel_adjust;
+        fixed_t x = src->x;
+        fixed_t y = src->y;
+        dst->x = (fixed_t)(((int64_t)m->a * x + (int64_t)m->c * y + tx) >> FMATRIX_SHIFT);
+        dst->y = (fixed_t)(((int64_t)m->b * x + (int64_t)m->d * y + ty) >> FMATRIX_SHIFT);
 
         // grow a bounding box around the points visited.
         if (dst->x < fctx->extent_min.x) fctx->extent_min.x = dst->x;
@@ -739,6 +2086,39 @@ void fctx_transform_points(FContext* fctx, uint16_t pcount, FPoint* ppoints, FPo
     }
 }
 
+bool fctx_bounds_visible(FContext* fctx, FPoint advance, const FPathBounds* bounds) {
+
+    /* Empty bounds mean the bounds are unknown. */
+    if (bounds->min_x > bounds->max_x) {
+        return true;
+    }
+    fctx_refresh_transform(fctx);
+
+    const FMatrix* m = &fctx->transform_matrix;
+    int64_t tx = m->tx + (int64_t)m->a * advance.x + (int64_t)m->c * advance.y;
+    int64_t ty = m->ty + (int64_t)m->b * advance.x + (int64_t)m->d * advance.y;
+
+    /* Transform the corners, without touching the fill extents. */
+    fixed_t xs[2] = { bounds->min_x, bounds->max_x };
+    fixed_t ys[2] = { bounds->min_y, bounds->max_y };
+    fixed_t min_x = INT32_MAX, min_y = INT32_MAX, max_x = INT32_MIN, max_y = INT32_MIN;
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            fixed_t x = (fixed_t)(((int64_t)m->a * xs[i] + (int64_t)m->c * ys[j] + tx) >> FMATRIX_SHIFT);
+            fixed_t y = (fixed_t)(((int64_t)m->b * xs[i] + (int64_t)m->d * ys[j] + ty) >> FMATRIX_SHIFT);
+            if (x < min_x) min_x = x;
+            if (y < min_y) min_y = y;
+            if (x > max_x) max_x = x;
+            if (y > max_y) max_y = y;
+        }
+    }
+
+    /* Allow a pixel of slack for subpixel adjustment and sampling. */
+    GRect b = fctx->flag_bounds;
+    return max_x >= INT_TO_FIXED(b.origin.x - 1) && min_x <= INT_TO_FIXED(b.origin.x + b.size.w + 1)
+        && max_y >= INT_TO_FIXED(b.origin.y - 1) && min_y <= INT_TO_FIXED(b.origin.y + b.size.h + 1);
+}
+
 static void exec_draw_func(FContext* fctx, FPoint advance, fctx_draw_cmd_func func, FPoint* ppoints, uint16_t pcount) {
     FPoint tpoints[3];
     fctx_transform_points(fctx, pcount, ppoints, tpoints, advance);
@@ -762,7 +2142,7 @@ void fctx_curve_to(FContext* fctx, FPoint cp0, FPoint cp1, FPoint p) {
 }
 
 void fctx_close_path(FContext* fctx) {
-    fctx_plot_edge(fctx, &fctx->path_cur_point, &fctx->path_init_point);
+    fctx_path_edge(fctx, &fctx->path_cur_point, &fctx->path_init_point);
     fctx->path_cur_point = fctx->path_init_point;
 }
 
@@ -770,132 +2150,457 @@ void fctx_draw_path_with_buffer(FContext* fctx, FPoint* points, FPoint* buffer,
 
     fctx_transform_points(fctx, num_points, points, buffer, FPointZero);
     for (uint32_t k = 0; k < num_points; ++k) {
-        fctx_plot_edge(fctx, buffer+k, buffer+((k+1) % num_points));
+        fctx_path_edge(fctx, buffer+k, buffer+((k+1) % num_points));
     }
 }
 
 void fctx_draw_path(FContext* fctx, FPoint* points, uint32_t num_points) {
 
-    FPoint* buffer = (FPoint*)malloc(num_points * sizeof(FPoint));
+    size_t size = num_points * sizeof(FPoint);
+    FPoint* buffer = (FPoint*)fctx_scratch_alloc(fctx, size);
     if (buffer) {
         fctx_draw_path_with_buffer(fctx, points, buffer, num_points);
-        free(buffer);
+        fctx_scratch_free(fctx, buffer, size);
+    }
+}
+
+// --------------------------------------------------------------------------
+// Path command streams
+// --------------------------------------------------------------------------
+
+static const uint8_t k_path_op_points[] = { 1, 1, 3, 2 };
+
+static const fctx_draw_cmd_func k_path_op_funcs[] = {
+    fctx_move_to_func, fctx_line_to_func, fctx_curve_to_func, fctx_quad_to_func
+};
+
+/* Reads either command stream one command at a time as absolute points.
+ * Legacy commands are a uint16 code followed by absolute fixed16_t params;
+ * compact commands are as described in fctx.h.
+ */
+typedef struct FPathReader {
+    const uint8_t* data;
+    const uint8_t* end;
+    bool compact;
+    bool error;
+    FPoint initpt;
+    FPoint curpt;
+    FPoint ctrlpt;
+} FPathReader;
+
+static bool fpath_reader_init(FPathReader* r, void* path_data, uint16_t length, bool compact) {
+    const uint8_t* data = path_data;
+    if (compact) {
+        if (!fpath_is_compact(path_data, length)) {
+            APP_LOG(APP_LOG_LEVEL_ERROR, "missing compact path header");
+            return false;
+        }
+        if (data[1] != FPATH_COMPACT_VERSION) {
+            APP_LOG(APP_LOG_LEVEL_ERROR, "unsupported compact path version %d", data[1]);
+            return false;
+        }
+        data += 2;
+    }
+    r->data = data;
+    r->end = (const uint8_t*)path_data + length;
+    r->compact = compact;
+    r->error = false;
+    r->initpt = FPointZero;
+    r->curpt = FPointZero;
+    r->ctrlpt = FPointZero;
+    return true;
+}
+
+static int16_t fpath_read_int16(FPathReader* r) {
+    int16_t value;
+    memcpy(&value, r->data, sizeof(value));
+    r->data += sizeof(value);
+    return value;
+}
+
+/* Read one coordinate.  Compact coordinates are relative to origin and wrap
+ * as fixed16_t; legacy coordinates are absolute.
+ */
+static fixed_t fpath_read_coord(FPathReader* r, fixed_t origin) {
+    if (!r->compact) {
+        if (r->end - r->data < 2) {
+            r->error = true;
+            return origin;
+        }
+        return fpath_read_int16(r);
+    }
+    if (r->data >= r->end) {
+        r->error = true;
+        return origin;
+    }
+    int32_t delta = (int8_t)*r->data++;
+    if (delta == FPATH_COMPACT_ESCAPE) {
+        if (r->end - r->data < 2) {
+            r->error = true;
+            return origin;
+        }
+        delta = (int16_t)(r->data[0] | (r->data[1] << 8));
+        r->data += 2;
+    }
+    return (fixed16_t)(uint16_t)(origin + delta);
+}
+
+static FPoint fpath_read_point(FPathReader* r) {
+    FPoint p;
+    p.x = fpath_read_coord(r, r->curpt.x);
+    p.y = fpath_read_coord(r, r->curpt.y);
+    return p;
+}
+
+/* Read the next command as absolute points.  Returns its FPathOp, or -1 at
+ * the end of the data or on error.
+ */
+static int fpath_read_command(FPathReader* r, FPoint* ppoints) {
+
+    if (r->data >= r->end) {
+        return -1;
+    }
+    int code;
+    if (r->compact) {
+        code = *r->data++;
+    } else if (r->end - r->data >= 2) {
+        code = (uint16_t)fpath_read_int16(r);
+    } else {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "truncated draw command");
+        r->error = true;
+        return -1;
+    }
+    int op;
+    switch (code) {
+        case 'M': // "moveto"
+            op = FPathOpMoveTo;
+            ppoints[0] = fpath_read_point(r);
+            r->initpt = ppoints[0];
+            break;
+        case 'Z': // "closepath"
+            op = FPathOpLineTo;
+            ppoints[0] = r->initpt;
+            break;
+        case 'L': // "lineto"
+            op = FPathOpLineTo;
+            ppoints[0] = fpath_read_point(r);
+            break;
+        case 'H': // "horizontal lineto"
+            op = FPathOpLineTo;
+            ppoints[0].x = fpath_read_coord(r, r->curpt.x);
+            ppoints[0].y = r->curpt.y;
+            break;
+        case 'V': // "vertical lineto"
+            op = FPathOpLineTo;
+            ppoints[0].x = r->curpt.x;
+            ppoints[0].y = fpath_read_coord(r, r->curpt.y);
+            break;
+        case 'C': // "cubic bezier curveto"
+            op = FPathOpCurveTo;
+            ppoints[0] = fpath_read_point(r);
+            ppoints[1] = fpath_read_point(r);
+            ppoints[2] = fpath_read_point(r);
+            r->ctrlpt = ppoints[1];
+            break;
+        case 'S': // "smooth cubic bezier curveto"
+            op = FPathOpCurveTo;
+            ppoints[0].x = r->curpt.x - r->ctrlpt.x + r->curpt.x;
+            ppoints[0].y = r->curpt.y - r->ctrlpt.y + r->curpt.y;
+            ppoints[1] = fpath_read_point(r);
+            ppoints[2] = fpath_read_point(r);
+            r->ctrlpt = ppoints[1];
+            break;
+        case 'Q': // "quadratic bezier curveto"
+            op = FPathOpQuadTo;
+            ppoints[0] = fpath_read_point(r);
+            ppoints[1] = fpath_read_point(r);
+            r->ctrlpt = ppoints[0];
+            break;
+        case 'T': // "smooth quadratic bezier curveto"
+            op = FPathOpQuadTo;
+            ppoints[0].x = r->curpt.x - r->ctrlpt.x + r->curpt.x;
+            ppoints[0].y = r->curpt.y - r->ctrlpt.y + r->curpt.y;
+            ppoints[1] = fpath_read_point(r);
+            r->ctrlpt = ppoints[0];
+            break;
+        default:
+            APP_LOG(APP_LOG_LEVEL_ERROR, "invalid draw command %d", code);
+            r->error = true;
+            return -1;
+    }
+    if (r->error) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "truncated draw command %d", code);
+        return -1;
+    }
+    r->curpt = ppoints[k_path_op_points[op] - 1];
+    return op;
+}
+
+static void fctx_draw_path_reader(FContext* fctx, FPoint advance, FPathReader* reader) {
+    FPoint ppoints[3];
+    int op;
+    while ((op = fpath_read_command(reader, ppoints)) >= 0) {
+        exec_draw_func(fctx, advance, k_path_op_funcs[op], ppoints, k_path_op_points[op]);
     }
 }
 
 void fctx_draw_commands(FContext* fctx, FPoint advance, void* path_data, uint16_t length) {
 
-    fctx_draw_cmd_func func;
-    uint16_t pcount;
-    FPoint initpt = {0, 0};
-    FPoint curpt = {0, 0};
-    FPoint ctrlpt = {0, 0};
+    FPathReader reader;
+    if (fpath_reader_init(&reader, path_data, length, fpath_is_compact(path_data, length))) {
+        fctx_draw_path_reader(fctx, advance, &reader);
+    }
+}
+
+void fctx_draw_compact_commands(FContext* fctx, FPoint advance, void* path_data, uint16_t length) {
+
+    FPathReader reader;
+    if (fpath_reader_init(&reader, path_data, length, true)) {
+        fctx_draw_path_reader(fctx, advance, &reader);
+    }
+}
+
+// --------------------------------------------------------------------------
+// Decoded paths
+// --------------------------------------------------------------------------
+
+static void fpath_decode_emit(FDecodedPath* path, FPathBounds* bounds, uint8_t op, const FPoint* ppoints,
+                              uint16_t* op_count, uint16_t* point_count) {
+    uint8_t pcount = k_path_op_points[op];
+    if (path) {
+        path->ops[*op_count] = op;
+        memcpy(path->points + *point_count, ppoints, pcount * sizeof(FPoint));
+    }
+    if (bounds) {
+        for (uint8_t k = 0; k < pcount; ++k) {
+            if (ppoints[k].x < bounds->min_x) bounds->min_x = ppoints[k].x;
+            if (ppoints[k].y < bounds->min_y) bounds->min_y = ppoints[k].y;
+            if (ppoints[k].x > bounds->max_x) bounds->max_x = ppoints[k].x;
+            if (ppoints[k].y > bounds->max_y) bounds->max_y = ppoints[k].y;
+        }
+    }
+    *op_count += 1;
+    *point_count += pcount;
+}
+
+/* Decode a command stream.  The first pass (with path NULL) only counts the
+ * ops and points; the second fills them in.  If bounds is given, it is grown
+ * around every point.
+ */
+static bool fpath_decode_pass(void* path_data, uint16_t length, FDecodedPath* path, FPathBounds* bounds,
+                              uint16_t* op_count, uint16_t* point_count) {
+
+    *op_count = 0;
+    *point_count = 0;
+
+    FPathReader reader;
+    if (!fpath_reader_init(&reader, path_data, length, fpath_is_compact(path_data, length))) {
+        return false;
+    }
     FPoint ppoints[3];
+    int op;
+    while ((op = fpath_read_command(&reader, ppoints)) >= 0) {
+        fpath_decode_emit(path, bounds, op, ppoints, op_count, point_count);
+    }
+    return !reader.error;
+}
 
-    void* path_data_end = path_data + length;
-    while (path_data < path_data_end) {
-
-        /* choose the draw function and parameter count. */
-        FPathDrawCommand* cmd = (FPathDrawCommand*)path_data;
-        fixed16_t* param = (fixed16_t*)&cmd->params;
-        switch (cmd->code) {
-            case 'M': // "moveto"
-                func = fctx_move_to_func;
-                pcount = 1;
-                ppoints[0].x = *param++;
-                ppoints[0].y = *param++;
-                curpt = ppoints[0];
-                initpt = curpt;
-                break;
-            case 'Z': // "closepath"
-                func = fctx_line_to_func;
-                pcount = 1;
-                ppoints[0] = initpt;
-                curpt = ppoints[0];
-                break;
-            case 'L': // "lineto"
-                func = fctx_line_to_func;
-                pcount = 1;
-                ppoints[0].x = *param++;
-                ppoints[0].y = *param++;
-                curpt = ppoints[0];
-                break;
-            case 'H': // "horizontal lineto"
-                func = fctx_line_to_func;
-                pcount = 1;
-                ppoints[0].x = *param++;
-                ppoints[0].y = curpt.y;
-                curpt.x = ppoints[0].x;
-                break;
-            case 'V': // "vertical lineto"
-                func = fctx_line_to_func;
-                pcount = 1;
-                ppoints[0].x = curpt.x;
-                ppoints[0].y = *param++;
-                curpt.y = ppoints[0].y;
-                break;
-            case 'C': // "cubic bezier curveto"
-                func = fctx_curve_to_func;
-                pcount = 3;
-                ppoints[0].x = *param++;
-                ppoints[0].y = *param++;
-                ppoints[1].x = *param++;
-                ppoints[1].y = *param++;
-                ppoints[2].x = *param++;
-                ppoints[2].y = *param++;
-                ctrlpt = ppoints[1];
-                curpt = ppoints[2];
-                break;
-            case 'S': // "smooth cubic bezier curveto"
-                func = fctx_curve_to_func;
-                pcount = 3;
-                ppoints[1].x = *param++;
-                ppoints[1].y = *param++;
-                ppoints[2].x = *param++;
-                ppoints[2].y = *param++;
-                ppoints[0].x = curpt.x - ctrlpt.x + curpt.x;
-                ppoints[0].y = curpt.y - ctrlpt.y + curpt.y;
-                ctrlpt = ppoints[1];
-                curpt = ppoints[2];
-                break;
-            case 'Q': // "quadratic bezier curveto"
-                func = fctx_curve_to_func;
-                pcount = 3;
-                ctrlpt.x = *param++;
-                ctrlpt.y = *param++;
-                ppoints[2].x = *param++;
-                ppoints[2].y = *param++;
-                ppoints[0].x = (curpt.x      + 2 * ctrlpt.x) / 3;
-                ppoints[0].y = (curpt.y      + 2 * ctrlpt.y) / 3;
-                ppoints[1].x = (ppoints[2].x + 2 * ctrlpt.x) / 3;
-                ppoints[1].y = (ppoints[2].y + 2 * ctrlpt.y) / 3;
-                curpt = ppoints[2];
-                break;
-            case 'T': // "smooth quadratic bezier curveto"
-                func = fctx_curve_to_func;
-                pcount = 3;
-                ctrlpt.x = curpt.x - ctrlpt.x + curpt.x;
-                ctrlpt.y = curpt.y - ctrlpt.y + curpt.y;
-                ppoints[2].x = *param++;
-                ppoints[2].y = *param++;
-                ppoints[0].x = (curpt.x      + 2 * ctrlpt.x) / 3;
-                ppoints[0].y = (curpt.y      + 2 * ctrlpt.y) / 3;
-                ppoints[1].x = (ppoints[2].x + 2 * ctrlpt.x) / 3;
-                ppoints[1].y = (ppoints[2].y + 2 * ctrlpt.y) / 3;
-                curpt = ppoints[2];
-                break;
-            default:
-                APP_LOG(APP_LOG_LEVEL_ERROR, "invalid draw command %d", cmd->code);
-                return;
+FDecodedPath* fpath_decode(void* path_data, uint16_t length) {
+    uint16_t op_count, point_count;
+    if (!fpath_decode_pass(path_data, length, NULL, NULL, &op_count, &point_count)) {
+        return NULL;
+    }
+    FDecodedPath* path = malloc(sizeof(FDecodedPath) + point_count * sizeof(FPoint) + op_count);
+    if (path) {
+        path->points = (FPoint*)(path + 1);
+        path->ops = (uint8_t*)(path->points + point_count);
+        fpath_decode_pass(path_data, length, path, NULL, &path->op_count, &path->point_count);
+    }
+    return path;
+}
+
+void fpath_decoded_destroy(FDecodedPath* path) {
+    free(path);
+}
+
+bool fpath_compute_bounds(void* path_data, uint16_t length, FPathBounds* bounds) {
+    uint16_t op_count, point_count;
+    bounds->min_x = INT16_MAX;
+    bounds->min_y = INT16_MAX;
+    bounds->max_x = INT16_MIN;
+    bounds->max_y = INT16_MIN;
+    return fpath_decode_pass(path_data, length, NULL, bounds, &op_count, &point_count) && point_count > 0;
+}
+
+#define DECODED_PATH_CHUNK 24
+
+void fctx_draw_decoded_path(FContext* fctx, FPoint advance, const FDecodedPath* path) {
+
+    /* Points are transformed in chunks; tpoints[0] is path->points[base]. */
+    FPoint tpoints[DECODED_PATH_CHUNK];
+    uint16_t base = 0;
+    uint16_t avail = 0;
+    uint16_t next = 0;
+    for (uint16_t k = 0; k < path->op_count; ++k) {
+        uint8_t op = path->ops[k];
+        uint8_t pcount = k_path_op_points[op];
+        if (next + pcount > base + avail) {
+            base = next;
+            avail = path->point_count - base;
+            if (avail > DECODED_PATH_CHUNK) avail = DECODED_PATH_CHUNK;
+            fctx_transform_points(fctx, avail, path->points + base, tpoints, advance);
+        }
+        k_path_op_funcs[op](fctx, tpoints + (next - base));
+        next += pcount;
+    }
+}
+
+/* Flatten the curves of a decoded path into lineto ops, or only count the
+ * points if path is NULL.
+ */
+static uint32_t fpath_flatten_pass(const FDecodedPath* curves, fixed_t tolerance, FDecodedPath* path) {
+
+    uint32_t count = 0;
+    FPoint cur = FPointZero;
+    FPoint* points = curves->points;
+    for (uint16_t k = 0; k < curves->op_count; ++k) {
+        uint8_t op = curves->ops[k];
+        uint8_t pcount = k_path_op_points[op];
+        FBezierStepper s;
+        uint16_t n = 1;
+        if (op == FPathOpCurveTo) {
+            n = fbezier_init_cubic(&s, &cur, points + 0, points + 1, points + 2, tolerance);
+        } else if (op == FPathOpQuadTo) {
+            n = fbezier_init_quad(&s, &cur, points + 0, points + 1, tolerance);
+        }
+        if (path) {
+            uint8_t flat_op = (op == FPathOpMoveTo) ? FPathOpMoveTo : FPathOpLineTo;
+            for (uint16_t i = 1; i < n; ++i) {
+                path->ops[count] = flat_op;
+                path->points[count++] = fbezier_step(&s);
+            }
+            path->ops[count] = flat_op;
+            path->points[count++] = points[pcount - 1];
+        } else {
+            count += n;
         }
+        cur = points[pcount - 1];
+        points += pcount;
+    }
+    return count;
+}
+
+/* Path space tolerance that stays within a quarter pixel at the given scale. */
+static fixed_t fpath_flatten_tolerance(FPoint scale_from, FPoint scale_to) {
+    fixed_t tolerance = FIXED_POINT_SCALE / 4;
+    fixed_t from[2] = { scale_from.x, scale_from.y };
+    fixed_t to[2] = { scale_to.x, scale_to.y };
+    for (int k = 0; k < 2; ++k) {
+        int64_t f = (from[k] < 0) ? -(int64_t)from[k] : from[k];
+        int64_t t = (to[k] < 0) ? -(int64_t)to[k] : to[k];
+        if (f > 0 && t > 0) {
+            int64_t axis = FIXED_POINT_SCALE / 4 * f / t;
+            if (axis < tolerance) tolerance = (fixed_t)axis;
+        }
+    }
+    return (tolerance < 1) ? 1 : tolerance;
+}
+
+FDecodedPath* fpath_flatten(void* path_data, uint16_t length, FPoint scale_from, FPoint scale_to) {
+
+    FDecodedPath* curves = fpath_decode(path_data, length);
+    if (!curves) {
+        return NULL;
+    }
+
+    fixed_t tolerance = fpath_flatten_tolerance(scale_from, scale_to);
+    uint32_t count = fpath_flatten_pass(curves, tolerance, NULL);
+    FDecodedPath* path = NULL;
+    if (count > UINT16_MAX) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "path too detailed to flatten");
+    } else {
+        path = malloc(sizeof(FDecodedPath) + count * (sizeof(FPoint) + 1));
+    }
+    if (path) {
+        path->op_count = count;
+        path->point_count = count;
+        path->points = (FPoint*)(path + 1);
+        path->ops = (uint8_t*)(path->points + count);
+        fpath_flatten_pass(curves, tolerance, path);
+    }
+
+    fpath_decoded_destroy(curves);
+    return path;
+}
 
-        /* advance to next draw command */
-        path_data = (void*)param;
+// --------------------------------------------------------------------------
+// Edge caches
+// --------------------------------------------------------------------------
+
+FEdgeCache* fedge_cache_create(uint16_t max_edges) {
+    FEdgeCache* cache = malloc(sizeof(FEdgeCache) + 2 * max_edges * sizeof(FPoint));
+    if (cache) {
+        cache->edge_capacity = max_edges;
+        cache->edges = (FPoint*)(cache + 1);
+        fedge_cache_invalidate(cache);
+    }
+    return cache;
+}
+
+void fedge_cache_invalidate(FEdgeCache* cache) {
+    cache->valid = false;
+    cache->path_data = NULL;
+    cache->length = 0;
+    cache->edge_count = 0;
+}
+
+void fedge_cache_destroy(FEdgeCache* cache) {
+    free(cache);
+}
 
-        if (func) {
-            exec_draw_func(fctx, advance, func, ppoints, pcount);
+static bool fedge_cache_matches(FEdgeCache* cache, FContext* fctx, FPoint advance, void* path_data, uint16_t length) {
+    const FMatrix* m = &fctx->transform_matrix;
+    const FMatrix* k = &cache->matrix;
+    return cache->valid
+        && cache->path_data == path_data && cache->length == length
+        && fpoint_equal(&cache->advance, &advance)
+        && cache->tolerance == fctx->curve_tolerance
+        && k->a == m->a && k->b == m->b && k->c == m->c && k->d == m->d
+        && k->tx == m->tx && k->ty == m->ty;
+}
+
+void fctx_draw_commands_cached(FContext* fctx, FEdgeCache* cache, FPoint advance, void* path_data, uint16_t length) {
+
+    fctx_refresh_transform(fctx);
+
+    if (fedge_cache_matches(cache, fctx, advance, path_data, length)) {
+        FPoint* e = cache->edges;
+        FPoint* end = e + 2 * cache->edge_count;
+        for (; e != end; e += 2) {
+            fctx_path_edge(fctx, e, e + 1);
         }
+        if (cache->extent_min.x < fctx->extent_min.x) fctx->extent_min.x = cache->extent_min.x;
+        if (cache->extent_min.y < fctx->extent_min.y) fctx->extent_min.y = cache->extent_min.y;
+        if (cache->extent_max.x > fctx->extent_max.x) fctx->extent_max.x = cache->extent_max.x;
+        if (cache->extent_max.y > fctx->extent_max.y) fctx->extent_max.y = cache->extent_max.y;
+        return;
     }
+
+    /* Draw normally, capturing the edges for next time. */
+    cache->valid = true;
+    cache->path_data = path_data;
+    cache->length = length;
+    cache->edge_count = 0;
+    cache->matrix = fctx->transform_matrix;
+    cache->advance = advance;
+    cache->tolerance = fctx->curve_tolerance;
+    cache->extent_min = FPoint(INT32_MAX, INT32_MAX);
+    cache->extent_max = FPoint(INT32_MIN, INT32_MIN);
+
+    FEdgeCache* outer = fctx->edge_capture;
+    fctx->edge_capture = cache;
+    fctx_draw_commands(fctx, advance, path_data, length);
+    fctx->edge_capture = outer;
 }
 
 // --------------------------------------------------------------------------
@@ -917,12 +2622,13 @@ void fctx_set_text_cap_height(FContext* fctx, FFont* font, int16_t pixels) {
 }
 
 fixed_t fctx_string_width(FContext* fctx, const char* text, FFont* font) {
+    FFontIndex* index = ffont_find_index(font);
     uint16_t code_point;
     uint16_t decode_state = 0;
     fixed_t width = 0;
     for (const char* p = text; *p; ++p) {
         if (0 == utf8_decode_byte(*p, &decode_state, &code_point)) {
-            FGlyph* glyph = ffont_glyph_info(font, code_point);
+            FGlyph* glyph = ffont_glyph_info_indexed(font, index, code_point);
             if (glyph) {
                 width += glyph->horiz_adv_x;
             }
@@ -931,8 +2637,136 @@ fixed_t fctx_string_width(FContext* fctx, const char* text, FFont* font) {
     return width * fctx->transform_scale_to.x / fctx->transform_scale_from.x;
 }
 
+static fixed_t fctx_anchor_offset(FFont* font, FTextAnchor anchor) {
+    if (anchor == FTextAnchorBottom) {
+        return -font->descent;
+    } else if (anchor == FTextAnchorMiddle) {
+        return -font->ascent / 2;
+    } else if (anchor == FTextAnchorCapMiddle) {
+        return -font->cap_height / 2;
+    } else if (anchor == FTextAnchorTop) {
+        return -font->ascent;
+    } else if (anchor == FTextAnchorCapTop) {
+        return -font->cap_height;
+    } else /* anchor == FTextAnchorBaseline) */ {
+        return 0;
+    }
+}
+
+/* Culls the glyphs of one line of text against the flag buffer.  Each glyph
+ * gets a cell from its origin to its advance, and from descent to ascent,
+ * padded for ink that overhangs the cell.  Cells are projected onto the
+ * screen direction of the baseline; since glyphs only advance along it, a
+ * cell wholly past the flag buffer means every later one is too.
+ */
+typedef struct FTextCuller {
+    const FMatrix* matrix;
+    bool enabled;
+    int32_t dir_x;
+    int32_t dir_y;
+    int64_t view_min;
+    int64_t view_max;
+    fixed_t cell_pad;
+    fixed_t cell_min_y;
+    fixed_t cell_max_y;
+} FTextCuller;
+
+static inline int64_t ftext_project(const FTextCuller* tc, fixed_t x, fixed_t y) {
+    return (int64_t)x * tc->dir_x + (int64_t)y * tc->dir_y;
+}
+
+static void ftext_culler_init(FTextCuller* tc, FContext* fctx, FFont* font) {
+
+    fctx_refresh_transform(fctx);
+    tc->matrix = &fctx->transform_matrix;
+
+    /* The baseline direction, scaled down to keep the projections in range. */
+    int32_t dx = tc->matrix->a;
+    int32_t dy = tc->matrix->b;
+    while (dx > INT16_MAX || dx < -INT16_MAX || dy > INT16_MAX || dy < -INT16_MAX) {
+        dx /= 2;
+        dy /= 2;
+    }
+    tc->dir_x = dx;
+    tc->dir_y = dy;
+    tc->enabled = dx != 0 || dy != 0;
+
+    GRect b = fctx->flag_bounds;
+    fixed_t xs[2] = { INT_TO_FIXED(b.origin.x - 1), INT_TO_FIXED(b.origin.x + b.size.w + 1) };
+    fixed_t ys[2] = { INT_TO_FIXED(b.origin.y - 1), INT_TO_FIXED(b.origin.y + b.size.h + 1) };
+    tc->view_min = INT64_MAX;
+    tc->view_max = INT64_MIN;
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            int64_t p = ftext_project(tc, xs[i], ys[j]);
+            if (p < tc->view_min) tc->view_min = p;
+            if (p > tc->view_max) tc->view_max = p;
+        }
+    }
+
+    tc->cell_pad = font->units_per_em / 2;
+    tc->cell_min_y = (font->descent < 0 ? font->descent : 0) - tc->cell_pad;
+    tc->cell_max_y = (font->ascent > 0 ? font->ascent : 0) + tc->cell_pad;
+}
+
+/* Returns -1 if the glyph cell lies wholly before the flag buffer along the
+ * baseline, 1 if wholly after, and 0 if it may be visible.
+ */
+static int ftext_culler_side(const FTextCuller* tc, FPoint origin, fixed_t width) {
+    if (!tc->enabled) {
+        return 0;
+    }
+    const FMatrix* m = tc->matrix;
+    fixed_t xs[2] = { origin.x - tc->cell_pad, origin.x + width + tc->cell_pad };
+    fixed_t ys[2] = { origin.y + tc->cell_min_y, origin.y + tc->cell_max_y };
+    int64_t min_p = INT64_MAX, max_p = INT64_MIN;
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            fixed_t x = (fixed_t)(((int64_t)m->a * xs[i] + (int64_t)m->c * ys[j] + m->tx) >> FMATRIX_SHIFT);
+            fixed_t y = (fixed_t)(((int64_t)m->b * xs[i] + (int64_t)m->d * ys[j] + m->ty) >> FMATRIX_SHIFT);
+            int64_t p = ftext_project(tc, x, y);
+            if (p < min_p) min_p = p;
+            if (p > max_p) max_p = p;
+        }
+    }
+    if (max_p < tc->view_min) {
+        return -1;
+    } else if (min_p > tc->view_max) {
+        return 1;
+    }
+    return 0;
+}
+
+static inline fixed16_t ftext_clamp16(fixed_t v) {
+    return v < INT16_MIN ? INT16_MIN : v > INT16_MAX ? INT16_MAX : (fixed16_t)v;
+}
+
+/* Draw one glyph, unless its bounds (or failing those, its cell) miss the
+ * flag buffer.  Culling by cell avoids paging in outlines that are not drawn.
+ */
+static void fctx_draw_glyph(FContext* fctx, FFont* font, FFontIndex* index, FGlyph* glyph, FPoint advance,
+                            const FTextCuller* tc) {
+    const FPathBounds* bounds = ffont_glyph_bounds_indexed(font, index, glyph);
+    FPathBounds cell;
+    if (!bounds) {
+        cell.min_x = ftext_clamp16(-tc->cell_pad);
+        cell.max_x = ftext_clamp16(glyph->horiz_adv_x + tc->cell_pad);
+        cell.min_y = ftext_clamp16(tc->cell_min_y);
+        cell.max_y = ftext_clamp16(tc->cell_max_y);
+        bounds = &cell;
+    }
+    if (!fctx_bounds_visible(fctx, advance, bounds)) {
+        return;
+    }
+    void* path_data = ffont_glyph_outline_indexed(font, index, glyph);
+    if (path_data) {
+        fctx_draw_commands(fctx, advance, path_data, glyph->path_data_length);
+    }
+}
+
 void fctx_draw_string(FContext* fctx, const char* text, FFont* font, GTextAlignment alignment, FTextAnchor anchor) {
 
+    FFontIndex* index = ffont_find_index(font);
     FPoint advance = {0, 0};
     uint16_t code_point;
     uint16_t decode_state;
@@ -943,7 +2777,7 @@ void fctx_draw_string(FContext* fctx, const char* text, FFont* font, GTextAlignm
         decode_state = 0;
         for (p = text; *p; ++p) {
             if (0 == utf8_decode_byte(*p, &decode_state, &code_point)) {
-                FGlyph* glyph = ffont_glyph_info(font, code_point);
+                FGlyph* glyph = ffont_glyph_info_indexed(font, index, code_point);
                 if (glyph) {
                     width += glyph->horiz_adv_x;
                 }
@@ -956,29 +2790,143 @@ void fctx_draw_string(FContext* fctx, const char* text, FFont* font, GTextAlignm
         }
     }
 
-    if (anchor == FTextAnchorBottom) {
-        advance.y = -font->descent;
-    } else if (anchor == FTextAnchorMiddle) {
-        advance.y = -font->ascent / 2;
-    } else if (anchor == FTextAnchorCapMiddle) {
-        advance.y = -font->cap_height / 2;
-    } else if (anchor == FTextAnchorTop) {
-        advance.y = -font->ascent;
-    } else if (anchor == FTextAnchorCapTop) {
-        advance.y = -font->cap_height;
-    } else /* anchor == FTextAnchorBaseline) */ {
-        advance.y = 0;
-    }
+    advance.y = fctx_anchor_offset(font, anchor);
+
+    FTextCuller culler;
+    ftext_culler_init(&culler, fctx, font);
 
     decode_state = 0;
     for (p = text; *p; ++p) {
         if (0 == utf8_decode_byte(*p, &decode_state, &code_point)) {
-            FGlyph* glyph = ffont_glyph_info(font, code_point);
+            FGlyph* glyph = ffont_glyph_info_indexed(font, index, code_point);
             if (glyph) {
-                void* path_data = ffont_glyph_outline(font, glyph);
-                fctx_draw_commands(fctx, advance, path_data, glyph->path_data_length);
+                int side = ftext_culler_side(&culler, advance, glyph->horiz_adv_x);
+                if (side > 0) {
+                    break;
+                } else if (side == 0) {
+                    fctx_draw_glyph(fctx, font, index, glyph, advance, &culler);
+                }
                 advance.x += glyph->horiz_adv_x;
             }
         }
     }
 }
+
+// --------------------------------------------------------------------------
+// Text layout
+// --------------------------------------------------------------------------
+
+FTextLayout* ftext_layout_create(const char* text, FFont* font, GTextAlignment alignment, FTextAnchor anchor) {
+    FTextLayout* layout = malloc(sizeof(FTextLayout));
+    if (layout) {
+        layout->glyph_count = 0;
+        layout->glyph_capacity = 0;
+        layout->glyphs = NULL;
+        layout->origins = NULL;
+        if (!ftext_layout_set_text(layout, text, font, alignment, anchor)) {
+            ftext_layout_destroy(layout);
+            return NULL;
+        }
+    }
+    return layout;
+}
+
+bool ftext_layout_set_text(FTextLayout* layout, const char* text, FFont* font, GTextAlignment alignment, FTextAnchor anchor) {
+
+    uint16_t code_point;
+    uint16_t decode_state = 0;
+    const char* p;
+
+    /* Every decoded code point needs at most one slot. */
+    uint16_t capacity = 0;
+    for (p = text; *p; ++p) {
+        if (0 == utf8_decode_byte(*p, &decode_state, &code_point)) {
+            ++capacity;
+        }
+    }
+    if (capacity > layout->glyph_capacity) {
+        FGlyph** glyphs = malloc(capacity * (sizeof(FGlyph*) + sizeof(FPoint)));
+        if (!glyphs) {
+            APP_LOG(APP_LOG_LEVEL_ERROR, "no memory for text layout of %d glyphs", capacity);
+            layout->glyph_count = 0;
+            return false;
+        }
+        free(layout->origins);
+        layout->origins = (FPoint*)glyphs;
+        layout->glyphs = (FGlyph**)(layout->origins + capacity);
+        layout->glyph_capacity = capacity;
+    }
+
+    FFontIndex* index = ffont_find_index(font);
+    layout->font = font;
+    layout->glyph_count = 0;
+    fixed_t width = 0;
+    decode_state = 0;
+    for (p = text; *p; ++p) {
+        if (0 == utf8_decode_byte(*p, &decode_state, &code_point)) {
+            FGlyph* glyph = ffont_glyph_info_indexed(font, index, code_point);
+            if (glyph) {
+                layout->glyphs[layout->glyph_count] = glyph;
+                layout->origins[layout->glyph_count].x = width;
+                ++layout->glyph_count;
+                width += glyph->horiz_adv_x;
+            }
+        }
+    }
+    layout->width = width;
+
+    FPoint offset;
+    if (alignment == GTextAlignmentRight) {
+        offset.x = -width;
+    } else if (alignment == GTextAlignmentCenter) {
+        offset.x = -width / 2;
+    } else {
+        offset.x = 0;
+    }
+    offset.y = fctx_anchor_offset(font, anchor);
+    for (uint16_t k = 0; k < layout->glyph_count; ++k) {
+        layout->origins[k].x += offset.x;
+        layout->origins[k].y = offset.y;
+    }
+    return true;
+}
+
+void ftext_layout_destroy(FTextLayout* layout) {
+    if (layout) {
+        free(layout->origins);
+        free(layout);
+    }
+}
+
+fixed_t fctx_layout_width(FContext* fctx, FTextLayout* layout) {
+    return layout->width * fctx->transform_scale_to.x / fctx->transform_scale_from.x;
+}
+
+void fctx_draw_layout(FContext* fctx, FTextLayout* layout) {
+
+    FFont* font = layout->font;
+    FFontIndex* index = ffont_find_index(font);
+    FTextCuller culler;
+    ftext_culler_init(&culler, fctx, font);
+
+    /* Origins never decrease, so search for the first glyph that is not
+     * wholly before the flag buffer. */
+    uint16_t lo = 0;
+    uint16_t hi = layout->glyph_count;
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if (ftext_culler_side(&culler, layout->origins[mid], layout->glyphs[mid]->horiz_adv_x) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (uint16_t k = lo; k < layout->glyph_count; ++k) {
+        FGlyph* glyph = layout->glyphs[k];
+        if (ftext_culler_side(&culler, layout->origins[k], glyph->horiz_adv_x) > 0) {
+            break;
+        }
+        fctx_draw_glyph(fctx, font, index, glyph, layout->origins[k], &culler);
+    }
+}
@@ -1,5 +1,32 @@
 
 #include "ffont.h"
+#include <pebble-utf8/pebble-utf8.h>
+
+static struct FFontIndex* ffont_create_index(FFont* font, bool resident);
+static void ffont_destroy_index(FFont* font);
+static bool ffont_create_pager(struct FFontIndex* index, ResHandle rh, uint16_t cache_size);
+static FGlyph* ffont_glyph_info_linear(FFont* font, uint16_t unicode);
+
+FGlyphRange* ffont_glyph_index(FFont* font) {
+    void* buffer = (void*)font;
+    void* index = buffer + sizeof(FFont);
+    return (FGlyphRange*)index;
+}
+
+FGlyph* ffont_glyph_table(FFont* font) {
+    void* buffer = (void*)font;
+    void* table = buffer + sizeof(FFont)
+                + font->glyph_index_length * sizeof(FGlyphRange);
+    return (FGlyph*)table;
+}
+
+void* ffont_path_data(FFont* font) {
+    void* buffer = (void*)font;
+    void* path_data = buffer + sizeof(FFont)
+                    + font->glyph_index_length * sizeof(FGlyphRange)
+                    + font->glyph_table_length * sizeof(FGlyph);
+    return path_data;
+}
 
 FFont* ffont_create_from_resource(uint32_t resource_id) {
     ResHandle rh = resource_get_handle(resource_id);
@@ -7,11 +34,171 @@ FFont* ffont_create_from_resource(uint32_t resource_id) {
     void* buffer = malloc(rs);
     if (buffer) {
         resource_load(rh, buffer, rs);
+        ffont_create_index((FFont*)buffer, true);
         return (FFont*)buffer;
     }
     return NULL;
 }
 
+/* Load just the header, range index and glyph table of a font resource. */
+static FFont* ffont_load_tables(ResHandle rh) {
+    FFont header;
+    if (resource_load_byte_range(rh, 0, (uint8_t*)&header, sizeof(FFont)) != sizeof(FFont)) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "font resource too short");
+        return NULL;
+    }
+    size_t rs = sizeof(FFont)
+              + header.glyph_index_length * sizeof(FGlyphRange)
+              + header.glyph_table_length * sizeof(FGlyph);
+    if (rs > resource_size(rh)) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "font resource too short");
+        return NULL;
+    }
+    void* buffer = malloc(rs);
+    if (buffer && resource_load_byte_range(rh, 0, buffer, rs) != rs) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "font resource too short");
+        free(buffer);
+        buffer = NULL;
+    }
+    return (FFont*)buffer;
+}
+
+FFont* ffont_create_paged_from_resource(uint32_t resource_id, uint16_t cache_size) {
+    ResHandle rh = resource_get_handle(resource_id);
+    FFont* font = ffont_load_tables(rh);
+    if (font) {
+        struct FFontIndex* index = ffont_create_index(font, false);
+        if (!index || !ffont_create_pager(index, rh, cache_size)) {
+            ffont_destroy(font);
+            return NULL;
+        }
+    }
+    return font;
+}
+
+/* Shell sort, for the handful of code points in a charset. */
+static void ffont_sort_code_points(uint16_t* a, uint16_t n) {
+    for (uint16_t gap = n / 2; gap > 0; gap /= 2) {
+        for (uint16_t i = gap; i < n; ++i) {
+            uint16_t v = a[i];
+            uint16_t j = i;
+            while (j >= gap && a[j - gap] > v) {
+                a[j] = a[j - gap];
+                j -= gap;
+            }
+            a[j] = v;
+        }
+    }
+}
+
+FFont* ffont_create_subset_from_resource(uint32_t resource_id, const char* charset) {
+    ResHandle rh = resource_get_handle(resource_id);
+    FFont* source = ffont_load_tables(rh);
+    /* A charset has at most one code point per byte; each needs its code
+     * point and its source glyph table index.
+     */
+    size_t max_count = strlen(charset);
+    uint16_t* code_points = malloc((max_count + 1) * 2 * sizeof(uint16_t));
+    if (!source || !code_points) {
+        free(source);
+        free(code_points);
+        return NULL;
+    }
+    uint16_t* glyph_ids = code_points + max_count + 1;
+    uint32_t source_path_data = sizeof(FFont)
+                              + source->glyph_index_length * sizeof(FGlyphRange)
+                              + source->glyph_table_length * sizeof(FGlyph);
+    FGlyph* source_table = ffont_glyph_table(source);
+
+    /* Decode the charset and sort it once. */
+    uint16_t decoded = 0;
+    uint16_t code_point;
+    uint16_t decode_state = 0;
+    for (const char* p = charset; *p; ++p) {
+        if (0 == utf8_decode_byte(*p, &decode_state, &code_point)) {
+            code_points[decoded++] = code_point;
+        }
+    }
+    ffont_sort_code_points(code_points, decoded);
+
+    /* Walk the sorted code points and the source ranges together, keeping the
+     * distinct code points that the font has.
+     */
+    FGlyphRange* source_range = ffont_glyph_index(source);
+    FGlyphRange* source_end = source_range + source->glyph_index_length;
+    uint16_t range_offset = 0;
+    uint16_t count = 0;
+    for (uint16_t k = 0; k < decoded; ++k) {
+        code_point = code_points[k];
+        if (count > 0 && code_points[count - 1] == code_point) {
+            continue;
+        }
+        while (source_range < source_end && code_point >= source_range->end) {
+            range_offset += source_range->end - source_range->begin;
+            ++source_range;
+        }
+        if (source_range == source_end) {
+            break;
+        }
+        if (code_point >= source_range->begin) {
+            code_points[count] = code_point;
+            glyph_ids[count] = range_offset + (code_point - source_range->begin);
+            ++count;
+        }
+    }
+
+    /* Runs of consecutive code points become ranges. */
+    uint16_t range_count = 0;
+    uint32_t path_data_length = 0;
+    for (uint16_t k = 0; k < count; ++k) {
+        if (k == 0 || code_points[k] != code_points[k - 1] + 1) {
+            ++range_count;
+        }
+        path_data_length += source_table[glyph_ids[k]].path_data_length;
+    }
+
+    size_t rs = sizeof(FFont)
+              + range_count * sizeof(FGlyphRange)
+              + count * sizeof(FGlyph)
+              + path_data_length;
+    FFont* font = malloc(rs);
+    if (font) {
+        *font = *source;
+        font->glyph_index_length = range_count;
+        font->glyph_table_length = count;
+        FGlyphRange* range = ffont_glyph_index(font) - 1;
+        FGlyph* glyph = ffont_glyph_table(font);
+        uint8_t* path_data = ffont_path_data(font);
+        uint16_t path_data_offset = 0;
+        for (uint16_t k = 0; k < count; ++k, ++glyph) {
+            if (k == 0 || code_points[k] != code_points[k - 1] + 1) {
+                ++range;
+                range->begin = code_points[k];
+            }
+            range->end = code_points[k] + 1;
+            FGlyph* source_glyph = source_table + glyph_ids[k];
+            *glyph = *source_glyph;
+            glyph->path_data_offset = path_data_offset;
+            if (resource_load_byte_range(rh, source_path_data + source_glyph->path_data_offset,
+                                         path_data + path_data_offset, source_glyph->path_data_length)
+                    != source_glyph->path_data_length) {
+                APP_LOG(APP_LOG_LEVEL_ERROR, "font resource too short");
+                free(font);
+                font = NULL;
+                break;
+            }
+            path_data_offset += source_glyph->path_data_length;
+        }
+        if (font) {
+            ffont_create_index(font, true);
+        }
+    }
+
+    free(code_points);
+    free(source);
+    return font;
+}
+
 FFont* ffont_load_from_resource_into_buffer(uint32_t resource_id, void* buffer) {
     ResHandle rh = resource_get_handle(resource_id);
     size_t rs = resource_size(rh);
@@ -22,28 +209,249 @@ FFont* ffont_load_from_resource_into_buffer(uint32_t resource_id, void* buffer)
     return NULL;
 }
 
-FGlyphRange* ffont_glyph_index(FFont* font) {
-    void* buffer = (void*)font;
-    void* index = buffer + sizeof(FFont);
-    return (FGlyphRange*)index;
+/*
+ * Glyph lookup tables, built when a font is created from a resource.  The
+ * font itself is the resource data as-is, so the tables are kept on the side,
+ * in a short list keyed by font.  Fonts loaded into a caller supplied buffer
+ * have no tables and use the linear range walk.
+ */
+#define FFONT_ASCII_BEGIN 0x20
+#define FFONT_ASCII_END 0x80
+
+/*
+ * Paged fonts keep only the header, range index and glyph table resident.
+ * Glyph outlines are loaded on demand into a cache of fixed size, which is
+ * kept packed: outlines are appended at the end, and evicting the least
+ * recently used outline slides the ones after it down.
+ */
+#define FFONT_CACHE_ENTRIES 32
+
+typedef struct FGlyphCacheEntry {
+    uint16_t glyph;
+    uint16_t offset;
+    uint16_t length;
+    uint16_t last_used;
+} FGlyphCacheEntry;
+
+typedef struct FFontPager {
+    ResHandle resource;
+    uint32_t path_data_offset;
+    uint16_t capacity;
+    uint16_t used;
+    uint16_t entry_count;
+    uint16_t clock;
+    uint32_t hits;
+    uint32_t misses;
+    FGlyphCacheEntry entries[FFONT_CACHE_ENTRIES];
+    uint8_t data[];
+} FFontPager;
+
+struct FFontIndex {
+    struct FFontIndex* next;
+    FFont* font;
+    FFontPager* pager;
+    /* Bounds of each glyph outline, or NULL if the outlines are not resident. */
+    FPathBounds* glyph_bounds;
+    /* Glyph table index + 1 of each ASCII code point, or 0 if none. */
+    uint16_t ascii[FFONT_ASCII_END - FFONT_ASCII_BEGIN];
+    /* Glyph table offset of the first glyph of each range. */
+    uint16_t range_offset[];
+};
+
+static FFontIndex* s_font_indexes = NULL;
+
+FFontIndex* ffont_find_index(FFont* font) {
+    if (s_font_indexes && s_font_indexes->font == font) {
+        return s_font_indexes;
+    }
+    FFontIndex** link = &s_font_indexes;
+    while (*link) {
+        FFontIndex* index = *link;
+        if (index->font == font) {
+            /* Keep the most recently used font at the head of the list. */
+            *link = index->next;
+            index->next = s_font_indexes;
+            s_font_indexes = index;
+            return index;
+        }
+        link = &index->next;
+    }
+    return NULL;
 }
 
-FGlyph* ffont_glyph_table(FFont* font) {
-    void* buffer = (void*)font;
-    void* table = buffer + sizeof(FFont)
-                + font->glyph_index_length * sizeof(FGlyphRange);
-    return (FGlyph*)table;
+/* Create the lookup index for a font.  If its outlines are resident, the
+ * bounds of each glyph are computed too.
+ */
+static FFontIndex* ffont_create_index(FFont* font, bool resident) {
+    FFontIndex* index = malloc(sizeof(FFontIndex) + font->glyph_index_length * sizeof(uint16_t));
+    if (!index) {
+        APP_LOG(APP_LOG_LEVEL_WARNING, "no memory for font index");
+        return NULL;
+    }
+    index->font = font;
+    index->pager = NULL;
+    index->glyph_bounds = NULL;
+
+    FGlyphRange* ranges = ffont_glyph_index(font);
+    uint16_t offset = 0;
+    for (uint16_t k = 0; k < font->glyph_index_length; ++k) {
+        index->range_offset[k] = offset;
+        offset += ranges[k].end - ranges[k].begin;
+    }
+
+    FGlyph* table = ffont_glyph_table(font);
+    for (uint16_t c = FFONT_ASCII_BEGIN; c < FFONT_ASCII_END; ++c) {
+        FGlyph* glyph = ffont_glyph_info_linear(font, c);
+        index->ascii[c - FFONT_ASCII_BEGIN] = glyph ? glyph - table + 1 : 0;
+    }
+
+    if (resident) {
+        index->glyph_bounds = malloc(font->glyph_table_length * sizeof(FPathBounds));
+        if (index->glyph_bounds) {
+            void* path_data = ffont_path_data(font);
+            for (uint16_t k = 0; k < font->glyph_table_length; ++k) {
+                fpath_compute_bounds(path_data + table[k].path_data_offset, table[k].path_data_length,
+                                     index->glyph_bounds + k);
+            }
+        } else {
+            APP_LOG(APP_LOG_LEVEL_WARNING, "no memory for glyph bounds");
+        }
+    }
+
+    index->next = s_font_indexes;
+    s_font_indexes = index;
+    return index;
 }
 
-void* ffont_path_data(FFont* font) {
-    void* buffer = (void*)font;
-    void* path_data = buffer + sizeof(FFont)
-                    + font->glyph_index_length * sizeof(FGlyphRange)
-                    + font->glyph_table_length * sizeof(FGlyph);
-    return path_data;
+static bool ffont_create_pager(FFontIndex* index, ResHandle rh, uint16_t cache_size) {
+    FFont* font = index->font;
+    FFontPager* pager = malloc(sizeof(FFontPager) + cache_size);
+    if (!pager) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "no memory for %d byte glyph cache", cache_size);
+        return false;
+    }
+    pager->resource = rh;
+    pager->path_data_offset = sizeof(FFont)
+                            + font->glyph_index_length * sizeof(FGlyphRange)
+                            + font->glyph_table_length * sizeof(FGlyph);
+    pager->capacity = cache_size;
+    pager->used = 0;
+    pager->entry_count = 0;
+    pager->clock = 0;
+    pager->hits = 0;
+    pager->misses = 0;
+    index->pager = pager;
+    return true;
+}
+
+static void ffont_pager_evict(FFontPager* pager) {
+    uint16_t lru = 0;
+    for (uint16_t k = 1; k < pager->entry_count; ++k) {
+        /* Compare ages rather than times, so that the clock may wrap. */
+        if ((uint16_t)(pager->clock - pager->entries[k].last_used) >
+            (uint16_t)(pager->clock - pager->entries[lru].last_used)) {
+            lru = k;
+        }
+    }
+    FGlyphCacheEntry victim = pager->entries[lru];
+    uint16_t tail = victim.offset + victim.length;
+    memmove(pager->data + victim.offset, pager->data + tail, pager->used - tail);
+    pager->used -= victim.length;
+    for (uint16_t k = 0; k < pager->entry_count; ++k) {
+        if (pager->entries[k].offset > victim.offset) {
+            pager->entries[k].offset -= victim.length;
+        }
+    }
+    pager->entries[lru] = pager->entries[--pager->entry_count];
+}
+
+static void* ffont_pager_outline(FFontPager* pager, uint16_t glyph_id, FGlyph* glyph) {
+
+    ++pager->clock;
+    for (uint16_t k = 0; k < pager->entry_count; ++k) {
+        FGlyphCacheEntry* entry = pager->entries + k;
+        if (entry->glyph == glyph_id) {
+            entry->last_used = pager->clock;
+            ++pager->hits;
+            return pager->data + entry->offset;
+        }
+    }
+
+    ++pager->misses;
+    uint16_t length = glyph->path_data_length;
+    if (length > pager->capacity) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "glyph %d (%d bytes) exceeds the glyph cache", glyph_id, length);
+        return NULL;
+    }
+    while (pager->entry_count == FFONT_CACHE_ENTRIES || pager->used + length > pager->capacity) {
+        ffont_pager_evict(pager);
+    }
+
+    FGlyphCacheEntry* entry = pager->entries + pager->entry_count++;
+    entry->glyph = glyph_id;
+    entry->offset = pager->used;
+    entry->length = length;
+    entry->last_used = pager->clock;
+    pager->used += length;
+    if (resource_load_byte_range(pager->resource, pager->path_data_offset + glyph->path_data_offset,
+                                 pager->data + entry->offset, length) != length) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "glyph %d outline truncated", glyph_id);
+        pager->used -= length;
+        --pager->entry_count;
+        return NULL;
+    }
+    return pager->data + entry->offset;
+}
+
+void ffont_cache_stats(FFont* font, uint32_t* hits, uint32_t* misses) {
+    FFontIndex* index = ffont_find_index(font);
+    FFontPager* pager = index ? index->pager : NULL;
+    *hits = pager ? pager->hits : 0;
+    *misses = pager ? pager->misses : 0;
+}
+
+static void ffont_destroy_index(FFont* font) {
+    FFontIndex* index = ffont_find_index(font);
+    if (index) {
+        s_font_indexes = index->next;
+        free(index->pager);
+        free(index->glyph_bounds);
+        free(index);
+    }
 }
 
 FGlyph* ffont_glyph_info(FFont* font, uint16_t unicode) {
+    return ffont_glyph_info_indexed(font, ffont_find_index(font), unicode);
+}
+
+FGlyph* ffont_glyph_info_indexed(FFont* font, FFontIndex* index, uint16_t unicode) {
+    if (!index) {
+        return ffont_glyph_info_linear(font, unicode);
+    }
+
+    if (unicode >= FFONT_ASCII_BEGIN && unicode < FFONT_ASCII_END) {
+        uint16_t k = index->ascii[unicode - FFONT_ASCII_BEGIN];
+        return k ? ffont_glyph_table(font) + (k - 1) : NULL;
+    }
+
+    /* Binary search for the last range that begins at or before unicode. */
+    FGlyphRange* ranges = ffont_glyph_index(font);
+    int32_t lo = 0;
+    int32_t hi = (int32_t)font->glyph_index_length - 1;
+    while (lo <= hi) {
+        int32_t mid = (lo + hi) / 2;
+        if (unicode < ranges[mid].begin) {
+            hi = mid - 1;
+        } else if (unicode >= ranges[mid].end) {
+            lo = mid + 1;
+        } else {
+            return ffont_glyph_table(font) + index->range_offset[mid] + (unicode - ranges[mid].begin);
+        }
+    }
+    return NULL;
+}
+
+static FGlyph* ffont_glyph_info_linear(FFont* font, uint16_t unicode) {
     FGlyphRange* range = ffont_glyph_index(font);
     FGlyphRange* end = range + font->glyph_index_length;
     uint16_t offset = 0;
@@ -67,7 +475,25 @@ FGlyph* ffont_glyph_info(FFont* font, uint16_t unicode) {
     return NULL;
 }
 
+const FPathBounds* ffont_glyph_bounds(FFont* font, FGlyph* glyph) {
+    return ffont_glyph_bounds_indexed(font, ffont_find_index(font), glyph);
+}
+
+const FPathBounds* ffont_glyph_bounds_indexed(FFont* font, FFontIndex* index, FGlyph* glyph) {
+    if (index && index->glyph_bounds) {
+        return index->glyph_bounds + (glyph - ffont_glyph_table(font));
+    }
+    return NULL;
+}
+
 void* ffont_glyph_outline(FFont* font, FGlyph* glyph) {
+    return ffont_glyph_outline_indexed(font, ffont_find_index(font), glyph);
+}
+
+void* ffont_glyph_outline_indexed(FFont* font, FFontIndex* index, FGlyph* glyph) {
+    if (index && index->pager) {
+        return ffont_pager_outline(index->pager, glyph - ffont_glyph_table(font), glyph);
+    }
     void* path_data = ffont_path_data(font);
     return path_data + glyph->path_data_offset;
 }
@@ -105,5 +531,6 @@ void ffont_debug_log(FFont* font, uint8_t log_level) {
 }
 
 void ffont_destroy(FFont* font) {
+    ffont_destroy_index(font);
     free(font);
 }
@@ -1,6 +1,15 @@
 
 #include "fpath.h"
 
+/* Reject compact paths written in a version of the format we cannot read. */
+static bool fpath_check_format(FPath* fpath) {
+    if (fpath_is_compact(fpath->data, fpath->size) && fpath->data[1] != FPATH_COMPACT_VERSION) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "unsupported compact path version %d", fpath->data[1]);
+        return false;
+    }
+    return true;
+}
+
 FPath* fpath_create_from_resource(uint32_t resource_id) {
     ResHandle res_handle = resource_get_handle(resource_id);
     size_t res_size = resource_size(res_handle);
@@ -9,7 +18,10 @@ FPath* fpath_create_from_resource(uint32_t resource_id) {
     if (fpath) {
         fpath->size = (int16_t)res_size;
         resource_load(res_handle, fpath->data, res_size);
-        return fpath;
+        if (fpath_check_format(fpath)) {
+            return fpath;
+        }
+        free(fpath);
     }
     return NULL;
 }
@@ -21,7 +33,9 @@ FPath* fpath_load_from_resource_into_buffer(uint32_t resource_id, void* buffer)
     if (fpath) {
         fpath->size = (int16_t)res_size;
         resource_load(res_handle, fpath->data, res_size);
-        return fpath;
+        if (fpath_check_format(fpath)) {
+            return fpath;
+        }
     }
     return NULL;
 }
@@ -29,3 +43,10 @@ FPath* fpath_load_from_resource_into_buffer(uint32_t resource_id, void* buffer)
 void fpath_destroy(FPath* fpath) {
     free(fpath);
 }
+
+/* Draw a path, unless its bounds (from fpath_compute_bounds) miss the frame. */
+void fctx_draw_fpath_bounded(FContext* fctx, FPoint advance, FPath* fpath, const FPathBounds* bounds) {
+    if (fctx_bounds_visible(fctx, advance, bounds)) {
+        fctx_draw_commands(fctx, advance, fpath->data, fpath->size);
+    }
+}